@@ -0,0 +1,742 @@
+// Adaptive Radix Tree for String Keys
+
+// std::map<std::string, double> (as in errors1.cpp) compares whole strings at
+// every level of its red-black tree: a lookup costs O(log n) string comparisons,
+// and keys that share a long prefix ("customer#1234...") compare the same
+// characters over and over again.
+
+// A radix tree (trie) instead consumes the key one byte per level, so a lookup
+// costs O(key length), independent of the number of keys. An adaptive radix
+// tree (ART, Leis et al.) makes that practical:
+//  - inner nodes adapt their size to the number of children:
+//      Node4   up to   4 children: 4 key bytes + 4 pointers (linear search)
+//      Node16  up to  16 children: 16 key bytes + 16 pointers (one SIMD compare)
+//      Node48  up to  48 children: 256-byte index + 48 pointers
+//      Node256 up to 256 children: 256 pointers (direct indexing)
+//  - path compression: a chain of nodes with one child each collapses into
+//    the prefix of the next node (up to maxPrefix bytes are stored in the node;
+//    lookups skip longer prefixes and verify the key at the leaf)
+//  - lazy expansion: a subtree with a single key is just its leaf
+// Keys are arbitrary bytes (also '\0'), so a key that is a prefix of another
+// key ("pi" and "pie") can't use a terminator byte: it is stored as the
+// "terminal" leaf of the inner node at which it ends.
+
+// Children are kept in byte order, so a walk over the tree visits the keys in
+// the same (lexicographic) order as std::map, and all keys with a given prefix
+// are exactly one subtree.
+// NOTE: there is no erase(); the tree is meant for tables that are bulk loaded
+// and then queried.
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+template<typename V>
+class ArtMap
+{
+private:
+	static constexpr std::size_t maxPrefix = 10;
+
+	enum class Type : std::uint8_t { Leaf, N4, N16, N48, N256 };
+
+	struct Node {
+		Type type;
+		explicit Node(Type t) : type(t) {}
+	};
+
+	// the key is stored inline behind the leaf (no std::string)
+	struct Leaf : Node {
+		V value;
+		std::uint32_t len;
+		Leaf(V&& v, std::size_t l) : Node(Type::Leaf), value(std::move(v)), len(static_cast<std::uint32_t>(l)) {}
+		std::string_view key() const {
+			return std::string_view(reinterpret_cast<char const*>(this + 1), len);
+		}
+	};
+
+	struct Inner : Node {
+		std::uint16_t count = 0;
+		std::uint32_t prefixLen = 0;
+		unsigned char prefix[maxPrefix];
+		Leaf* terminal = nullptr;          // the key that ends at this node
+		explicit Inner(Type t) : Node(t) {}
+	};
+
+	struct Node4 : Inner {
+		unsigned char keys[4] = {};
+		Node* children[4] = {};
+		Node4() : Inner(Type::N4) {}
+	};
+
+	struct Node16 : Inner {
+		unsigned char keys[16] = {};
+		Node* children[16] = {};
+		Node16() : Inner(Type::N16) {}
+	};
+
+	struct Node48 : Inner {
+		unsigned char index[256] = {};     // 0: no child, else position + 1
+		Node* children[48] = {};
+		Node48() : Inner(Type::N48) {}
+	};
+
+	struct Node256 : Inner {
+		Node* children[256] = {};
+		Node256() : Inner(Type::N256) {}
+	};
+
+	Node* root = nullptr;
+	std::size_t numKeys = 0;
+
+	static Leaf* makeLeaf(std::string_view key, V value) {
+		void* mem = ::operator new(sizeof(Leaf) + key.size());
+		Leaf* leaf = new (mem) Leaf(std::move(value), key.size());
+		std::memcpy(leaf + 1, key.data(), key.size());
+		return leaf;
+	}
+
+	static void destroy(Node* n) {
+		if (n == nullptr) {
+			return;
+		}
+		if (n->type == Type::Leaf) {
+			Leaf* leaf = static_cast<Leaf*>(n);
+			leaf->~Leaf();
+			::operator delete(leaf);
+			return;
+		}
+		Inner* in = static_cast<Inner*>(n);
+		destroy(in->terminal);
+		forEachChild(in, [](unsigned char, Node* child) {
+			destroy(child);
+		});
+		deleteInner(in);
+	}
+
+	static void deleteInner(Inner* n) {
+		switch (n->type) {
+		case Type::N4:   delete static_cast<Node4*>(n); break;
+		case Type::N16:  delete static_cast<Node16*>(n); break;
+		case Type::N48:  delete static_cast<Node48*>(n); break;
+		case Type::N256: delete static_cast<Node256*>(n); break;
+		default: break;
+		}
+	}
+
+	static Inner* makeInner(std::size_t numChildren) {
+		if (numChildren <= 4) {
+			return new Node4;
+		}
+		if (numChildren <= 16) {
+			return new Node16;
+		}
+		if (numChildren <= 48) {
+			return new Node48;
+		}
+		return new Node256;
+	}
+
+	static void setPrefix(Inner* n, std::string_view p) {
+		n->prefixLen = static_cast<std::uint32_t>(p.size());
+		std::memmove(n->prefix, p.data(), std::min(p.size(), maxPrefix));
+	}
+
+	// the smallest key below n (all keys below n share the full prefix of n)
+	static Leaf const* minLeaf(Node const* n) {
+		while (n->type != Type::Leaf) {
+			Inner const* in = static_cast<Inner const*>(n);
+			if (in->terminal) {
+				return in->terminal;
+			}
+			Node const* first = nullptr;
+			forEachChild(in, [&](unsigned char, Node* child) {
+				if (!first) {
+					first = child;
+				}
+			});
+			n = first;
+		}
+		return static_cast<Leaf const*>(n);
+	}
+
+	// the complete prefix of n, which starts at byte depth of its keys
+	// (only the first maxPrefix bytes are stored in the node itself)
+	static std::string_view fullPrefix(Inner const* n, std::size_t depth) {
+		if (n->prefixLen <= maxPrefix) {
+			return std::string_view(reinterpret_cast<char const*>(n->prefix), n->prefixLen);
+		}
+		return minLeaf(n)->key().substr(depth, n->prefixLen);
+	}
+
+	static Node** findChild(Inner* n, unsigned char b) {
+		switch (n->type) {
+		case Type::N4: {
+			auto* n4 = static_cast<Node4*>(n);
+			for (unsigned i = 0; i < n4->count; ++i) {
+				if (n4->keys[i] == b) {
+					return &n4->children[i];
+				}
+			}
+			return nullptr;
+		}
+		case Type::N16: {
+			auto* n16 = static_cast<Node16*>(n);
+#if defined(__SSE2__)
+			// compare all 16 key bytes at once, ignore the unused ones
+			__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)),
+			                             _mm_loadu_si128(reinterpret_cast<__m128i const*>(n16->keys)));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(cmp)) & ((1u << n16->count) - 1);
+			return mask ? &n16->children[std::countr_zero(mask)] : nullptr;
+#else
+			for (unsigned i = 0; i < n16->count; ++i) {
+				if (n16->keys[i] == b) {
+					return &n16->children[i];
+				}
+			}
+			return nullptr;
+#endif
+		}
+		case Type::N48: {
+			auto* n48 = static_cast<Node48*>(n);
+			return n48->index[b] ? &n48->children[n48->index[b] - 1] : nullptr;
+		}
+		case Type::N256: {
+			auto* n256 = static_cast<Node256*>(n);
+			return n256->children[b] ? &n256->children[b] : nullptr;
+		}
+		default:
+			return nullptr;
+		}
+	}
+
+	static Node const* findChild(Inner const* n, unsigned char b) {
+		Node** slot = findChild(const_cast<Inner*>(n), b);
+		return slot ? *slot : nullptr;
+	}
+
+	// calls f(byte, child) for all children in byte order
+	template<typename F>
+	static void forEachChild(Inner const* n, F&& f) {
+		switch (n->type) {
+		case Type::N4: {
+			auto* n4 = static_cast<Node4 const*>(n);
+			for (unsigned i = 0; i < n4->count; ++i) {
+				f(n4->keys[i], n4->children[i]);
+			}
+			break;
+		}
+		case Type::N16: {
+			auto* n16 = static_cast<Node16 const*>(n);
+			for (unsigned i = 0; i < n16->count; ++i) {
+				f(n16->keys[i], n16->children[i]);
+			}
+			break;
+		}
+		case Type::N48: {
+			auto* n48 = static_cast<Node48 const*>(n);
+			for (unsigned b = 0; b < 256; ++b) {
+				if (n48->index[b]) {
+					f(static_cast<unsigned char>(b), n48->children[n48->index[b] - 1]);
+				}
+			}
+			break;
+		}
+		case Type::N256: {
+			auto* n256 = static_cast<Node256 const*>(n);
+			for (unsigned b = 0; b < 256; ++b) {
+				if (n256->children[b]) {
+					f(static_cast<unsigned char>(b), n256->children[b]);
+				}
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	template<std::size_t Cap>
+	static void insertSorted(unsigned char (&keys)[Cap], Node* (&children)[Cap], std::uint16_t& count,
+	                         unsigned char b, Node* child) {
+		unsigned pos = 0;
+		while (pos < count && keys[pos] < b) {
+			++pos;
+		}
+		std::memmove(keys + pos + 1, keys + pos, count - pos);
+		std::memmove(children + pos + 1, children + pos, (count - pos) * sizeof(Node*));
+		keys[pos] = b;
+		children[pos] = child;
+		++count;
+	}
+
+	static void copyHeader(Inner* to, Inner const* from) {
+		to->count = from->count;
+		to->prefixLen = from->prefixLen;
+		std::memcpy(to->prefix, from->prefix, maxPrefix);
+		to->terminal = from->terminal;
+	}
+
+	// adds a child to the node in ref, replacing the node by the next
+	// larger node type if it is full
+	static void addChild(Node*& ref, unsigned char b, Node* child) {
+		Inner* n = static_cast<Inner*>(ref);
+		switch (n->type) {
+		case Type::N4: {
+			auto* n4 = static_cast<Node4*>(n);
+			if (n4->count < 4) {
+				insertSorted(n4->keys, n4->children, n4->count, b, child);
+				return;
+			}
+			auto* n16 = new Node16;
+			copyHeader(n16, n4);
+			std::memcpy(n16->keys, n4->keys, 4);
+			std::memcpy(n16->children, n4->children, 4 * sizeof(Node*));
+			delete n4;
+			ref = n16;
+			break;
+		}
+		case Type::N16: {
+			auto* n16 = static_cast<Node16*>(n);
+			if (n16->count < 16) {
+				insertSorted(n16->keys, n16->children, n16->count, b, child);
+				return;
+			}
+			auto* n48 = new Node48;
+			copyHeader(n48, n16);
+			for (unsigned i = 0; i < 16; ++i) {
+				n48->index[n16->keys[i]] = static_cast<unsigned char>(i + 1);
+				n48->children[i] = n16->children[i];
+			}
+			delete n16;
+			ref = n48;
+			break;
+		}
+		case Type::N48: {
+			auto* n48 = static_cast<Node48*>(n);
+			if (n48->count < 48) {
+				n48->children[n48->count] = child;
+				n48->index[b] = static_cast<unsigned char>(++n48->count);
+				return;
+			}
+			auto* n256 = new Node256;
+			copyHeader(n256, n48);
+			for (unsigned k = 0; k < 256; ++k) {
+				if (n48->index[k]) {
+					n256->children[k] = n48->children[n48->index[k] - 1];
+				}
+			}
+			delete n48;
+			ref = n256;
+			break;
+		}
+		case Type::N256: {
+			auto* n256 = static_cast<Node256*>(n);
+			n256->children[b] = child;
+			++n256->count;
+			return;
+		}
+		default:
+			return;
+		}
+		addChild(ref, b, child);         // into the grown node
+	}
+
+	// puts a leaf whose key continues after depth into n
+	static void place(Node*& ref, Leaf* leaf, std::size_t depth) {
+		std::string_view key = leaf->key();
+		if (key.size() == depth) {
+			static_cast<Inner*>(ref)->terminal = leaf;
+		}
+		else {
+			addChild(ref, static_cast<unsigned char>(key[depth]), leaf);
+		}
+	}
+
+	static std::size_t commonPrefix(std::string_view a, std::string_view b) {
+		std::size_t n = std::min(a.size(), b.size());
+		std::size_t i = 0;
+		while (i < n && a[i] == b[i]) {
+			++i;
+		}
+		return i;
+	}
+
+	std::pair<V*, bool> insert(Node*& ref, std::string_view key, std::size_t depth, V& value) {
+		if (ref == nullptr) {
+			Leaf* leaf = makeLeaf(key, std::move(value));
+			ref = leaf;
+			++numKeys;
+			return {&leaf->value, true};
+		}
+
+		if (ref->type == Type::Leaf) {
+			Leaf* old = static_cast<Leaf*>(ref);
+			if (old->key() == key) {
+				return {&old->value, false};
+			}
+			// lazy expansion ends here: both leaves go below a new node
+			// whose prefix is the part the two keys have in common
+			std::size_t lcp = commonPrefix(old->key().substr(depth), key.substr(depth));
+			Node* n = new Node4;
+			setPrefix(static_cast<Inner*>(n), key.substr(depth, lcp));
+			Leaf* leaf = makeLeaf(key, std::move(value));
+			place(n, old, depth + lcp);
+			place(n, leaf, depth + lcp);
+			ref = n;
+			++numKeys;
+			return {&leaf->value, true};
+		}
+
+		Inner* n = static_cast<Inner*>(ref);
+		if (n->prefixLen > 0) {
+			std::string_view prefix = fullPrefix(n, depth);
+			std::size_t p = commonPrefix(prefix, key.substr(depth));
+			if (p < prefix.size()) {
+				// the key leaves the compressed path at p: split the path
+				// into a new node (prefix[0, p)) and the old one (after p)
+				Node* parent = new Node4;
+				setPrefix(static_cast<Inner*>(parent), prefix.substr(0, p));
+				auto b = static_cast<unsigned char>(prefix[p]);
+				setPrefix(n, prefix.substr(p + 1));
+				addChild(parent, b, n);
+				Leaf* leaf = makeLeaf(key, std::move(value));
+				place(parent, leaf, depth + p);
+				ref = parent;
+				++numKeys;
+				return {&leaf->value, true};
+			}
+			depth += prefix.size();
+		}
+
+		if (key.size() == depth) {
+			if (n->terminal) {
+				return {&n->terminal->value, false};
+			}
+			n->terminal = makeLeaf(key, std::move(value));
+			++numKeys;
+			return {&n->terminal->value, true};
+		}
+		auto b = static_cast<unsigned char>(key[depth]);
+		if (Node** child = findChild(n, b)) {
+			return insert(*child, key, depth + 1, value);
+		}
+		Leaf* leaf = makeLeaf(key, std::move(value));
+		addChild(ref, b, leaf);
+		++numKeys;
+		return {&leaf->value, true};
+	}
+
+	// builds the tree for [first, last), sorted and without duplicates,
+	// whose keys all agree in their first depth bytes
+	template<typename It>
+	static Node* build(It first, It last, std::size_t depth) {
+		if (last - first == 1) {
+			return makeLeaf(first->first, std::move(first->second));
+		}
+		// sorted: the common prefix of the first and the last key
+		// is the common prefix of all keys
+		std::string_view lo = first->first;
+		std::string_view hi = (last - 1)->first;
+		std::size_t lcp = commonPrefix(lo.substr(depth), hi.substr(depth));
+		std::size_t d = depth + lcp;
+
+		It it = first;
+		Leaf* terminal = nullptr;
+		if (lo.size() == d) {
+			terminal = makeLeaf(it->first, std::move(it->second));
+			++it;
+		}
+		std::size_t numChildren = 0;
+		for (It j = it; j != last; ++numChildren) {
+			unsigned char b = static_cast<unsigned char>(j->first[d]);
+			j = std::find_if(j, last, [&](auto const& e) {
+				return static_cast<unsigned char>(e.first[d]) != b;
+			});
+		}
+
+		Node* n = makeInner(numChildren);
+		setPrefix(static_cast<Inner*>(n), lo.substr(depth, lcp));
+		static_cast<Inner*>(n)->terminal = terminal;
+		while (it != last) {
+			unsigned char b = static_cast<unsigned char>(it->first[d]);
+			It groupEnd = std::find_if(it, last, [&](auto const& e) {
+				return static_cast<unsigned char>(e.first[d]) != b;
+			});
+			addChild(n, b, build(it, groupEnd, d + 1));
+			it = groupEnd;
+		}
+		return n;
+	}
+
+	template<typename F>
+	static void walk(Node* n, F& f) {
+		if (n->type == Type::Leaf) {
+			Leaf* leaf = static_cast<Leaf*>(n);
+			f(leaf->key(), leaf->value);
+			return;
+		}
+		Inner* in = static_cast<Inner*>(n);
+		if (in->terminal) {
+			f(in->terminal->key(), in->terminal->value);
+		}
+		forEachChild(in, [&](unsigned char, Node* child) {
+			walk(child, f);
+		});
+	}
+
+	static std::size_t memoryOf(Node const* n) {
+		switch (n->type) {
+		case Type::Leaf: return sizeof(Leaf) + static_cast<Leaf const*>(n)->len;
+		case Type::N4:   return sizeof(Node4);
+		case Type::N16:  return sizeof(Node16);
+		case Type::N48:  return sizeof(Node48);
+		case Type::N256: return sizeof(Node256);
+		}
+		return 0;
+	}
+
+public:
+	ArtMap() = default;
+
+	// bulk load from unsorted (key, value) pairs: sort once, then build every
+	// node top-down with its final size (no node growth, no path splits)
+	// as with std::map::insert(), the first of several equal keys wins
+	template<typename InputIt>
+	ArtMap(InputIt first, InputIt last) {
+		std::vector<std::pair<std::string, V>> elems(first, last);
+		std::stable_sort(elems.begin(), elems.end(), [](auto const& a, auto const& b) {
+			return a.first < b.first;
+		});
+		elems.erase(std::unique(elems.begin(), elems.end(), [](auto const& a, auto const& b) {
+			return a.first == b.first;
+		}), elems.end());
+		if (!elems.empty()) {
+			root = build(elems.begin(), elems.end(), 0);
+		}
+		numKeys = elems.size();
+	}
+
+	ArtMap(std::initializer_list<std::pair<std::string, V>> il)
+	 : ArtMap(il.begin(), il.end()) {
+	}
+
+	ArtMap(ArtMap const&) = delete;
+	ArtMap& operator= (ArtMap const&) = delete;
+
+	ArtMap(ArtMap&& other) noexcept
+	 : root(std::exchange(other.root, nullptr)), numKeys(std::exchange(other.numKeys, 0)) {
+	}
+
+	ArtMap& operator= (ArtMap&& other) noexcept {
+		std::swap(root, other.root);
+		std::swap(numKeys, other.numKeys);
+		return *this;
+	}
+
+	~ArtMap() {
+		destroy(root);
+	}
+
+	std::size_t size() const { return numKeys; }
+	bool empty() const { return numKeys == 0; }
+
+	// returns the value of the key and whether it was inserted
+	// (an existing value is left unchanged)
+	std::pair<V*, bool> insert(std::string_view key, V value) {
+		return insert(root, key, 0, value);
+	}
+
+	V& operator[](std::string_view key) {
+		return *insert(key, V{}).first;
+	}
+
+	// O(key length): one byte per level, prefixes longer than maxPrefix are
+	// skipped and checked together with the rest of the key at the leaf
+	V const* find(std::string_view key) const {
+		Node const* n = root;
+		std::size_t depth = 0;
+		while (n != nullptr) {
+			if (n->type == Type::Leaf) {
+				Leaf const* leaf = static_cast<Leaf const*>(n);
+				return leaf->key() == key ? &leaf->value : nullptr;
+			}
+			Inner const* in = static_cast<Inner const*>(n);
+			if (in->prefixLen > 0) {
+				if (key.size() - depth < in->prefixLen ||
+				    std::memcmp(in->prefix, key.data() + depth, std::min<std::size_t>(in->prefixLen, maxPrefix)) != 0) {
+					return nullptr;
+				}
+				depth += in->prefixLen;
+			}
+			if (depth == key.size()) {
+				Leaf const* t = in->terminal;
+				return t && t->key() == key ? &t->value : nullptr;
+			}
+			n = findChild(in, static_cast<unsigned char>(key[depth++]));
+		}
+		return nullptr;
+	}
+
+	V* find(std::string_view key) {
+		return const_cast<V*>(std::as_const(*this).find(key));
+	}
+
+	bool contains(std::string_view key) const {
+		return find(key) != nullptr;
+	}
+
+	// calls f(key, value) for all keys in lexicographic order
+	template<typename F>
+	void forEach(F f) {
+		if (root) {
+			walk(root, f);
+		}
+	}
+
+	template<typename F>
+	void forEach(F f) const {
+		const_cast<ArtMap*>(this)->forEach([&](std::string_view k, V& v) {
+			f(k, std::as_const(v));
+		});
+	}
+
+	// calls f(key, value) for all keys that start with prefix, in order
+	// (descends to the subtree of the prefix, then walks only that subtree)
+	template<typename F>
+	void forEachWithPrefix(std::string_view prefix, F f) {
+		Node* n = root;
+		std::size_t depth = 0;
+		while (n != nullptr) {
+			if (n->type == Type::Leaf) {
+				Leaf* leaf = static_cast<Leaf*>(n);
+				if (leaf->key().substr(0, prefix.size()) == prefix) {
+					f(leaf->key(), leaf->value);
+				}
+				return;
+			}
+			Inner* in = static_cast<Inner*>(n);
+			std::string_view p = fullPrefix(in, depth);
+			std::size_t rest = prefix.size() - depth;
+			std::size_t len = std::min(rest, p.size());
+			if (p.substr(0, len) != prefix.substr(depth, len)) {
+				return;
+			}
+			if (rest <= p.size()) {
+				walk(n, f);
+				return;
+			}
+			depth += p.size();
+			Node** child = findChild(in, static_cast<unsigned char>(prefix[depth++]));
+			n = child ? *child : nullptr;
+		}
+	}
+
+	template<typename F>
+	void forEachWithPrefix(std::string_view prefix, F f) const {
+		const_cast<ArtMap*>(this)->forEachWithPrefix(prefix, [&](std::string_view k, V& v) {
+			f(k, std::as_const(v));
+		});
+	}
+
+	// bytes allocated for nodes and leaves (including the keys)
+	std::size_t memoryUsage() const {
+		std::size_t bytes = 0;
+		auto count = [&](auto& self, Node const* n) -> void {
+			bytes += memoryOf(n);
+			if (n->type != Type::Leaf) {
+				Inner const* in = static_cast<Inner const*>(n);
+				if (in->terminal) {
+					bytes += memoryOf(in->terminal);
+				}
+				forEachChild(in, [&](unsigned char, Node* child) {
+					self(self, child);
+				});
+			}
+		};
+		if (root) {
+			count(count, root);
+		}
+		return bytes;
+	}
+};
+
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+
+int main()
+{
+	ArtMap<double> coll = {{"pi", 3.14}, {"e", 2.72}, {"", 0}, {"phi", 1.62}, {"pie", 0.5}};
+	coll.forEach([](std::string_view k, double v) {
+		std::cout << '"' << k << "\": " << v << ' ';            // "": 0 "e": 2.72 "phi": 1.62 "pi": 3.14 "pie": 0.5
+	});
+	std::cout << '\n';
+	coll.forEachWithPrefix("pi", [](std::string_view k, double) {
+		std::cout << k << ' ';                                   // pi pie
+	});
+	std::cout << '\n' << *coll.find("phi") << ' ' << coll.contains("p") << '\n';   // 1.62 0
+
+	// 1M keys with long shared prefixes: ArtMap vs. std::map
+	constexpr std::size_t n = 1'000'000;
+	std::mt19937 rnd(42);
+	std::vector<std::pair<std::string, double>> elems;
+	for (std::size_t i = 0; i < n; ++i) {
+		elems.emplace_back("config/region-" + std::to_string(rnd() % 16) + "/customer#" + std::to_string(rnd()), double(i));
+	}
+	std::map<std::string, double> treeMap(elems.begin(), elems.end());
+	ArtMap<double> art(elems.begin(), elems.end());
+
+	std::vector<std::string> probes;
+	for (std::size_t i = 0; i < n; ++i) {
+		probes.push_back(elems[rnd() % n].first);
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	auto t0 = Clock::now();
+	std::size_t hits1 = 0;
+	for (std::string const& p : probes) {
+		hits1 += treeMap.find(p) != treeMap.end();
+	}
+	auto t1 = Clock::now();
+	std::size_t hits2 = 0;
+	for (std::string const& p : probes) {
+		hits2 += art.contains(p);
+	}
+	auto t2 = Clock::now();
+	std::size_t inRegion = 0;
+	art.forEachWithPrefix("config/region-7/", [&](std::string_view, double) {
+		++inRegion;
+	});
+
+	// a std::map node: 3 pointers and the color (32 bytes), the pair, and
+	// the characters of keys that don't fit into the string itself
+	std::size_t mapBytes = 0;
+	for (auto const& [k, v] : treeMap) {
+		mapBytes += 32 + sizeof(std::pair<std::string const, double>) + (k.size() > 15 ? k.size() + 1 : 0);
+	}
+
+	std::cout << "std::map: " << ms(t1 - t0) << " ms (" << hits1 << " hits), "
+	          << mapBytes / (1024 * 1024) << " MiB\n";
+	std::cout << "ArtMap:   " << ms(t2 - t1) << " ms (" << hits2 << " hits), "
+	          << art.memoryUsage() / (1024 * 1024) << " MiB\n";
+	std::cout << inRegion << " keys in region-7\n";
+}
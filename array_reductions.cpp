@@ -0,0 +1,160 @@
+// Unrolled Reductions over std::array with Fold Expressions
+
+// For std::array<T, N> the number of elements is part of the type, so a reduction
+// doesn't need a loop at all: std::make_index_sequence<N> gives us the indices
+// 0, 1, ..., N-1 as a parameter pack and a fold expression expands the body once
+// per element.
+
+// A plain fold like (... + a[I]) still is one long dependency chain:
+//      ((((a[0] + a[1]) + a[2]) + a[3]) + ...)
+// every addition has to wait for the previous one.
+// With K independent accumulators, element i goes to accumulator i % K, so K
+// additions can be in flight at the same time. The accumulators are combined
+// once at the end.
+
+// Note that for floating-point types this changes the order of the operations,
+// so the result might differ in the last bits from a sequential sum. That is
+// exactly why the compiler is not allowed to do this transformation itself
+// (without -ffast-math).
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+
+// one step of the unrolled loop: accumulator L consumes element S*K + L
+// The condition is a constant expression, so no branch survives the compilation
+template<std::size_t S, std::size_t K, std::size_t N, typename T, typename Op, typename Get,
+         std::size_t... L>
+constexpr void reduceStep(std::array<T, K>& acc, Op& op, Get& get, std::index_sequence<L...>)
+{
+    ((S * K + L < N ? void(acc[L] = op(acc[L], get(S * K + L))) : void()), ...);
+}
+
+template<std::size_t K, std::size_t N, typename T, typename Op, typename Get, std::size_t... S>
+constexpr void reduceSteps(std::array<T, K>& acc, Op& op, Get& get, std::index_sequence<S...>)
+{
+    (reduceStep<S, K, N>(acc, op, get, std::make_index_sequence<K>{}), ...);
+}
+
+template<typename T, typename Op, std::size_t K, std::size_t... L>
+constexpr T combine(std::array<T, K> const& acc, Op& op, std::index_sequence<0, L...>)
+{
+    T result = acc[0];
+    ((result = op(result, acc[L])), ...);
+    return result;
+}
+
+// generic kernel: reduces get(0), ..., get(N-1) with op using K accumulators
+// - init has to be an identity of op (0 for +, 1 for *, ...),
+//   because every accumulator starts with it
+// - K is clamped to N, so small arrays don't pay for unused accumulators
+template<std::size_t K, std::size_t N, typename T, typename Op, typename Get>
+constexpr T unrolledReduce(T init, Op op, Get get)
+{
+    static_assert(K > 0, "at least one accumulator is required");
+    if constexpr (N == 0) {
+        return init;
+    }
+    else {
+        constexpr std::size_t lanes = K < N ? K : N;
+        constexpr std::size_t steps = (N + lanes - 1) / lanes;
+        std::array<T, lanes> acc{};
+        for (auto& a : acc) {
+            a = init;
+        }
+        reduceSteps<lanes, N>(acc, op, get, std::make_index_sequence<steps>{});
+        return combine(acc, op, std::make_index_sequence<lanes>{});
+    }
+}
+
+
+// the kernels themselves
+// K (the number of accumulators) is the first template parameter, so that it
+// can be specified explicitly while T and N are still deduced:
+//      sum<8>(coll);
+
+template<std::size_t K = 4, typename T, std::size_t N>
+constexpr T sum(std::array<T, N> const& coll)
+{
+    return unrolledReduce<K, N>(T{}, std::plus<>{},
+                                [&](std::size_t i) { return coll[i]; });
+}
+
+template<std::size_t K = 4, typename T, std::size_t N>
+constexpr T product(std::array<T, N> const& coll)
+{
+    return unrolledReduce<K, N>(T{1}, std::multiplies<>{},
+                                [&](std::size_t i) { return coll[i]; });
+}
+
+template<std::size_t K = 4, typename T, std::size_t N>
+constexpr T dot(std::array<T, N> const& a, std::array<T, N> const& b)
+{
+    return unrolledReduce<K, N>(T{}, std::plus<>{},
+                                [&](std::size_t i) { return a[i] * b[i]; });
+}
+
+// min and max have no identity for arbitrary T, but they are idempotent,
+// so starting every accumulator with coll[0] is fine
+template<std::size_t K = 4, typename T, std::size_t N>
+constexpr T min(std::array<T, N> const& coll)
+{
+    static_assert(N > 0, "min() of an empty array");
+    return unrolledReduce<K, N>(coll[0], [](T const& x, T const& y) { return y < x ? y : x; },
+                                [&](std::size_t i) { return coll[i]; });
+}
+
+template<std::size_t K = 4, typename T, std::size_t N>
+constexpr T max(std::array<T, N> const& coll)
+{
+    static_assert(N > 0, "max() of an empty array");
+    return unrolledReduce<K, N>(coll[0], [](T const& x, T const& y) { return y < x ? x : y; },
+                                [&](std::size_t i) { return coll[i]; });
+}
+
+// all() and any() don't short-circuit:
+// for small N evaluating every element without branches is faster
+// than a data-dependent early exit
+template<std::size_t K = 4, typename T, std::size_t N, typename Pred>
+constexpr bool all(std::array<T, N> const& coll, Pred pred)
+{
+    return unrolledReduce<K, N>(true, [](bool x, bool y) { return x & y; },
+                                [&](std::size_t i) { return static_cast<bool>(pred(coll[i])); });
+}
+
+template<std::size_t K = 4, typename T, std::size_t N, typename Pred>
+constexpr bool any(std::array<T, N> const& coll, Pred pred)
+{
+    return unrolledReduce<K, N>(false, [](bool x, bool y) { return x | y; },
+                                [&](std::size_t i) { return static_cast<bool>(pred(coll[i])); });
+}
+
+
+// everything is constexpr, so the kernels can also be evaluated at compile time
+constexpr std::array<int, 7> primes = {2, 3, 5, 7, 11, 13, 17};
+
+static_assert(sum(primes) == 58);
+static_assert(sum<1>(primes) == sum<16>(primes));
+static_assert(product<2>(primes) == 510510);
+static_assert(dot(primes, primes) == 666);
+static_assert(::min(primes) == 2 && ::max<3>(primes) == 17);
+static_assert(all(primes, [](int p) { return p > 1; }));
+static_assert(!any(primes, [](int p) { return p % 2 == 0 && p > 2; }));
+static_assert(sum(std::array<int, 0>{}) == 0);
+
+
+#include <iostream>
+
+int main()
+{
+    std::array<double, 16> coll{};
+    for (std::size_t i = 0; i < coll.size(); ++i) {
+        coll[i] = 0.5 * i;
+    }
+
+    std::cout << "sum:     " << sum<8>(coll) << '\n';
+    std::cout << "dot:     " << dot(coll, coll) << '\n';
+    std::cout << "min/max: " << ::min(coll) << ' ' << ::max(coll) << '\n';
+}
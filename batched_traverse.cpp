@@ -0,0 +1,142 @@
+// Batched Traversal with Group Prefetching
+
+// traverse(np, paths...) from fold_expressions.cpp follows one path at a time:
+//      np ->* left ->* right ->* ...
+// each hop needs the address loaded by the previous hop, so if the nodes are
+// not in the cache, every hop is a full memory round trip and the CPU has
+// nothing else to do in the meantime.
+
+// If many roots have to follow the same path, the hops of different roots are
+// independent. Group prefetching processes the roots in groups of G:
+//  - stage 0 issues a prefetch for every root of the group
+//  - stage k loads the k-th member of every node in the group (hopefully
+//    already in the cache) and issues a prefetch for the resulting nodes
+// So instead of one outstanding cache miss there are up to G of them, and the
+// latency of one hop is paid roughly once per group instead of once per root.
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+struct Node {
+    int value;
+    Node* left;
+    Node* right;
+    Node(int i = 0) : value(i), left(nullptr), right(nullptr) {}
+};
+
+auto left = &Node::left;
+auto right = &Node::right;
+
+template<typename T, typename ... TP>
+Node* traverse(T np, TP... paths) {
+    return (np ->* ... ->* paths);
+}
+
+
+// a prefetch is only a hint: it never faults, not even for nullptr
+inline void prefetch(void const* p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+// one stage: advance every node of the group by one member and prefetch the result
+// Unlike traverse(), a nullptr on the way simply propagates to the result
+template<typename TP>
+void advanceGroup(Node** cur, std::size_t g, TP path)
+{
+    for (std::size_t i = 0; i < g; ++i) {
+        cur[i] = cur[i] ? cur[i] ->* path : nullptr;
+        prefetch(cur[i]);
+    }
+}
+
+// out[i] = traverse(roots[i], paths...) for all i < n
+// Group is the number of misses we try to keep in flight
+// (about the number of line fill buffers of the core, 10-16 on current x86 CPUs)
+template<std::size_t Group = 16, typename ... TP>
+void traverseBatch(Node* const* roots, Node** out, std::size_t n, TP... paths)
+{
+    static_assert(Group > 0, "group must not be empty");
+    Node* cur[Group];
+    for (std::size_t base = 0; base < n; base += Group) {
+        std::size_t g = std::min(Group, n - base);
+        for (std::size_t i = 0; i < g; ++i) {
+            cur[i] = roots[base + i];
+            prefetch(cur[i]);
+        }
+        (advanceGroup(cur, g, paths), ...);
+        std::copy(cur, cur + g, out + base);
+    }
+}
+
+template<std::size_t Group = 16, typename ... TP>
+std::vector<Node*> traverseBatch(std::vector<Node*> const& roots, TP... paths)
+{
+    std::vector<Node*> out(roots.size());
+    traverseBatch<Group>(roots.data(), out.data(), roots.size(), paths...);
+    return out;
+}
+
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+
+int main()
+{
+    // many small trees whose nodes are scattered over a large heap area
+    // each tree is a zigzag of depth 8: root->left->right->left->...
+    constexpr std::size_t numTrees = 1 << 19;
+    constexpr std::size_t depth = 8;
+    std::vector<std::unique_ptr<Node>> pool;
+    pool.reserve((depth + 1) * numTrees);
+    for (std::size_t i = 0; i < (depth + 1) * numTrees; ++i) {
+        pool.push_back(std::make_unique<Node>(static_cast<int>(i)));
+    }
+    std::shuffle(pool.begin(), pool.end(), std::mt19937{42});
+
+    std::vector<Node*> roots(numTrees);
+    for (std::size_t i = 0; i < numTrees; ++i) {
+        Node* node = pool[(depth + 1) * i].get();
+        roots[i] = node;
+        for (std::size_t d = 1; d <= depth; ++d) {
+            Node* next = pool[(depth + 1) * i + d].get();
+            (d % 2 ? node->left : node->right) = next;
+            node = next;
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    // NOTE: for very short paths (2-3 hops) the out-of-order engine of the CPU
+    // already overlaps the independent iterations of the simple loop,
+    // so batching only pays off for longer paths.
+    auto t0 = Clock::now();
+    long sum1 = 0;
+    for (Node* root : roots) {
+        sum1 += traverse(root, left, right, left, right, left, right, left, right)->value;
+    }
+    auto t1 = Clock::now();
+    std::vector<Node*> out(numTrees);
+    auto t2 = Clock::now();
+    traverseBatch(roots.data(), out.data(), numTrees,
+                  left, right, left, right, left, right, left, right);
+    auto t3 = Clock::now();
+    long sum2 = 0;
+    for (Node* node : out) {
+        sum2 += node->value;
+    }
+
+    std::cout << "one at a time: " << ms(t1 - t0) << " ms\n";
+    std::cout << "batched:       " << ms(t3 - t2) << " ms\n";
+    std::cout << (sum1 == sum2 ? "same result\n" : "DIFFERENT RESULT\n");
+}
@@ -0,0 +1,316 @@
+// Blocked Bloom Filter in Front of a Customer Set
+
+// If most lookups in a set are misses, each miss still pays for the full
+// lookup: hashing, finding the bucket, and walking its chain (with a cache
+// miss per node) just to find nothing.
+
+// A Bloom filter answers "definitely not in the set" or "maybe in the set"
+// from a small bit array. Only "maybe" goes on to the real set.
+// A classic Bloom filter sets k bits anywhere in the array, so a probe costs
+// up to k cache misses. A blocked Bloom filter first selects one block with
+// the hash and sets all k bits of a key inside that block:
+//  - a block is 256 bits (8 words of 32 bits), aligned to 32 bytes,
+//    so it never spans two cache lines: one probe = one cache line
+//  - every key sets exactly one bit in each of the 8 words
+//    ("split block" filter, as used by Apache Parquet), so a probe is
+//    8 independent tests that map directly onto one 256-bit SIMD operation
+
+// Bloom filters can't remove keys. After erase() the bits of the key stay set
+// and only cause more false positives until the filter is rebuilt, which
+// happens whenever the underlying set rehashes.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+class BlockedBloomFilter
+{
+private:
+	struct alignas(32) Block {
+		std::uint32_t words[8];
+	};
+
+	// odd constants from the Parquet specification: multiplying the lower
+	// 32 bits of the hash by salt[i] and keeping the top 5 bits selects
+	// one bit in word i
+	static constexpr std::uint32_t salt[8] = {
+		0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+		0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+	};
+
+	std::unique_ptr<Block[]> blocks;
+	std::size_t numBlocks = 0;
+
+	// the upper 32 bits select the block (multiply-shift instead of modulo)
+	std::size_t blockIndex(std::uint64_t h) const {
+		return static_cast<std::size_t>(((h >> 32) * numBlocks) >> 32);
+	}
+
+	static Block mask(std::uint32_t key) {
+		Block m;
+		for (int i = 0; i < 8; ++i) {
+			m.words[i] = std::uint32_t(1) << ((key * salt[i]) >> 27);
+		}
+		return m;
+	}
+
+public:
+	BlockedBloomFilter() = default;
+
+	// sized for n keys with the given false-positive rate
+	// (the bits per key of a split block filter, approximated as in Parquet)
+	BlockedBloomFilter(std::size_t n, double falsePositiveRate) {
+		double bitsPerKey = -8.0 / std::log(1.0 - std::pow(falsePositiveRate, 1.0 / 8));
+		numBlocks = std::max<std::size_t>(1, static_cast<std::size_t>(
+		                                      std::ceil(double(n) * bitsPerKey / 256)));
+		blocks.reset(new Block[numBlocks]);
+		std::memset(static_cast<void*>(blocks.get()), 0, numBlocks * sizeof(Block));
+	}
+
+	std::size_t sizeInBytes() const {
+		return numBlocks * sizeof(Block);
+	}
+
+	// h has to be a well-mixed 64-bit hash
+	void insert(std::uint64_t h) {
+		Block& b = blocks[blockIndex(h)];
+		Block m = mask(static_cast<std::uint32_t>(h));
+		for (int i = 0; i < 8; ++i) {
+			b.words[i] |= m.words[i];
+		}
+	}
+
+	bool mayContain(std::uint64_t h) const {
+		if (numBlocks == 0) {
+			return false;
+		}
+		Block const& b = blocks[blockIndex(h)];
+		auto key = static_cast<std::uint32_t>(h);
+#if defined(__AVX2__)
+		// compute the 8 bit positions in one go, and test all of them at once:
+		// mayContain if (block & mask) == mask, i.e. testc(block, mask)
+		__m256i s = _mm256_setr_epi32(salt[0], salt[1], salt[2], salt[3],
+		                              salt[4], salt[5], salt[6], salt[7]);
+		__m256i shift = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(key), s), 27);
+		__m256i m = _mm256_sllv_epi32(_mm256_set1_epi32(1), shift);
+		__m256i block = _mm256_load_si256(reinterpret_cast<__m256i const*>(b.words));
+		return _mm256_testc_si256(block, m) != 0;
+#else
+		// a loop without branches the compiler can vectorize
+		Block m = mask(key);
+		std::uint32_t missing = 0;
+		for (int i = 0; i < 8; ++i) {
+			missing |= m.words[i] & ~b.words[i];
+		}
+		return missing == 0;
+#endif
+	}
+};
+
+
+// BloomFilteredSet<> puts a filter in front of a std::unordered_set
+// (or any set with the same interface) using the set's own hash functor
+// If the functors are transparent, contains() works with any key type they
+// accept, e.g. probing a Customer set with a std::string_view.
+template<typename Set>
+class BloomFilteredSet
+{
+private:
+	Set set;
+	BlockedBloomFilter filter;
+	double falsePositiveRate;
+	std::size_t filterBuckets = 0;       // bucket_count() when the filter was built
+
+	// std::hash<> results are not necessarily well mixed (the identity for
+	// integers), and the filter uses all 64 bits
+	template<typename K>
+	std::uint64_t hashOf(K const& key) const {
+		std::uint64_t h = static_cast<std::uint64_t>(set.hash_function()(key));
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// size the filter for as many elements as the set can hold before its
+	// next rehash, so we only rebuild when the set rehashes
+	void rebuild() {
+		filterBuckets = set.bucket_count();
+		auto capacity = static_cast<std::size_t>(double(filterBuckets) * set.max_load_factor());
+		filter = BlockedBloomFilter(std::max(capacity, set.size()), falsePositiveRate);
+		for (auto const& elem : set) {
+			filter.insert(hashOf(elem));
+		}
+	}
+
+public:
+	using value_type = typename Set::value_type;
+
+	explicit BloomFilteredSet(double fpr = 0.01) : falsePositiveRate(fpr) {
+		rebuild();
+	}
+
+	template<typename... Args>
+	bool emplace(Args&&... args) {
+		auto [pos, inserted] = set.emplace(std::forward<Args>(args)...);
+		if (inserted) {
+			if (set.bucket_count() != filterBuckets) {
+				rebuild();
+			}
+			else {
+				filter.insert(hashOf(*pos));
+			}
+		}
+		return inserted;
+	}
+
+	bool insert(value_type const& v) {
+		return emplace(v);
+	}
+
+	// the bits of the key stay in the filter until the next rebuild
+	// (heterogeneous erase(key) of the set is C++23, heterogeneous find()
+	// is C++20, so the key is looked up first and erased by position)
+	template<typename K>
+	std::size_t erase(K const& key) {
+		auto pos = set.find(key);
+		if (pos == set.end()) {
+			return 0;
+		}
+		set.erase(pos);
+		return 1;
+	}
+
+	template<typename K>
+	bool contains(K const& key) const {
+		return filter.mayContain(hashOf(key)) && set.find(key) != set.end();
+	}
+
+	std::size_t size() const {
+		return set.size();
+	}
+	std::size_t filterBytes() const {
+		return filter.sizeInBytes();
+	}
+	Set const& underlying() const {
+		return set;
+	}
+};
+
+
+// Customer and its functors (a simpler version of the ones in variadic_base_classes.cpp)
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+struct Customer
+{
+private:
+	std::string name;
+public:
+	Customer(std::string const& n) : name(n) {}
+	std::string getName() const { return name; }
+	std::string_view getNameView() const noexcept { return name; }
+};
+
+struct CustomerEq
+{
+	using is_transparent = void;
+
+	bool operator() (Customer const& c1, Customer const& c2) const
+	{
+		return c1.getNameView() == c2.getNameView();
+	}
+	bool operator() (Customer const& c, std::string_view n) const
+	{
+		return c.getNameView() == n;
+	}
+	bool operator() (std::string_view n, Customer const& c) const
+	{
+		return n == c.getNameView();
+	}
+};
+
+struct CustomerHash
+{
+	using is_transparent = void;
+
+	std::size_t operator() (Customer const& c) const {
+		return std::hash<std::string_view>()(c.getNameView());
+	}
+	std::size_t operator() (std::string_view n) const {
+		return std::hash<std::string_view>()(n);
+	}
+};
+
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+int main()
+{
+	using CustomerSet = std::unordered_set<Customer, CustomerHash, CustomerEq>;
+
+	BloomFilteredSet<CustomerSet> coll(0.01);
+	constexpr std::size_t n = 1'000'000;
+	for (std::size_t i = 0; i < n; ++i) {
+		coll.emplace("customer#" + std::to_string(i));
+	}
+
+	// 95% misses
+	std::vector<std::string> probes;
+	for (std::size_t i = 0; i < n; ++i) {
+		probes.push_back("customer#" + std::to_string(i % 20 == 0 ? i : i + n));
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	auto t0 = Clock::now();
+	std::size_t hits1 = 0;
+	for (std::string const& p : probes) {
+		hits1 += coll.underlying().find(std::string_view(p)) != coll.underlying().end();
+	}
+	auto t1 = Clock::now();
+	std::size_t hits2 = 0;
+	for (std::string const& p : probes) {
+		hits2 += coll.contains(std::string_view(p));
+	}
+	auto t2 = Clock::now();
+
+	// measured false-positive rate on keys that are certainly not in the set
+	BlockedBloomFilter const probeOnly = [&] {
+		BlockedBloomFilter f(n, 0.01);
+		for (std::size_t i = 0; i < n; ++i) {
+			f.insert(std::hash<std::size_t>()(i) * 0x9E3779B97F4A7C15ull);
+		}
+		return f;
+	}();
+	std::size_t falsePositives = 0;
+	for (std::size_t i = n; i < 2 * n; ++i) {
+		falsePositives += probeOnly.mayContain(std::hash<std::size_t>()(i) * 0x9E3779B97F4A7C15ull);
+	}
+
+	std::cout << "set only:    " << ms(t1 - t0) << " ms (" << hits1 << " hits)\n";
+	std::cout << "with filter: " << ms(t2 - t1) << " ms (" << hits2 << " hits)\n";
+	std::cout << "filter size: " << coll.filterBytes() / 1024 << " KiB, false positives: "
+	          << 100.0 * falsePositives / n << "%\n";
+
+	// erase by name, without constructing a Customer
+	std::size_t erased = coll.erase(std::string_view("customer#42"));
+	std::cout << erased << ' ' << coll.contains(std::string_view("customer#42")) << ' '
+	          << coll.size() << '\n';                                  // 1 0 999999
+}
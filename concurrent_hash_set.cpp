@@ -0,0 +1,540 @@
+// Sharded Concurrent Hash Set with Lock-free Reads
+
+// Sharing a std::unordered_set between threads behind one reader-writer lock
+// doesn't scale: even a shared (read) lock writes to the lock word, so every
+// lookup moves the cache line of the lock from core to core.
+
+// ConcurrentHashSet<> uses the same hash and equality functors as the
+// standard containers (e.g. CustomerHash and CustomerEq), but
+//  - the elements are spread over independent shards by the upper bits of
+//    their hash, each shard with its own writer mutex, so writers to different
+//    shards don't wait for each other
+//  - readers take no lock at all: every slot of a shard table is an atomic
+//    pointer to an immutable entry, and a lookup only loads these pointers
+//  - if a shard table gets too full, a larger table is created, but the
+//    entries are moved over incrementally, a few slots with every following
+//    write, so no single insert pays for copying the whole shard
+
+// Without locks, a writer can't know when a reader is done with an entry it
+// has removed (or a table it has replaced). So removed objects are not freed
+// immediately, but "retired" and freed only when no reader that could have
+// seen them is still running (epoch-based reclamation).
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// Epoch-based reclamation ---------------------------------------------------
+
+// Every reader announces the global epoch it starts in. An object retired in
+// epoch E can be freed as soon as every active reader has announced an
+// epoch > E (such a reader started after the object was unlinked).
+class EpochManager
+{
+private:
+	static constexpr std::size_t maxThreads = 256;
+
+	struct alignas(64) Slot {
+		std::atomic<std::uint64_t> epoch{0};        // 0: not in a read section
+		std::atomic<bool> used{false};
+	};
+
+	struct Retired {
+		std::uint64_t epoch;
+		void* ptr;
+		void (*deleter)(void*);
+	};
+
+	std::atomic<std::uint64_t> globalEpoch{1};
+	Slot slots[maxThreads];
+	std::mutex retiredMutex;
+	std::vector<Retired> retired;
+
+	// each thread occupies one slot for its lifetime
+	struct ThreadSlot {
+		Slot* slot = nullptr;
+		unsigned depth = 0;
+		~ThreadSlot() {
+			if (slot) {
+				slot->used.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	ThreadSlot& threadSlot() {
+		thread_local ThreadSlot ts;
+		if (ts.slot == nullptr) {
+			for (Slot& s : slots) {
+				bool expected = false;
+				if (!s.used.load(std::memory_order_relaxed)
+				    && s.used.compare_exchange_strong(expected, true)) {
+					ts.slot = &s;
+					break;
+				}
+			}
+			if (ts.slot == nullptr) {
+				throw std::runtime_error("EpochManager: too many threads");
+			}
+		}
+		return ts;
+	}
+
+	void reclaim() {
+		// pairs with the fence in Guard: either we see the epoch of a reader,
+		// or the reader sees everything unlinked before this point
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::uint64_t minActive = std::numeric_limits<std::uint64_t>::max();
+		for (Slot& s : slots) {
+			std::uint64_t e = s.epoch.load();
+			if (e != 0 && e < minActive) {
+				minActive = e;
+			}
+		}
+		auto keep = retired.begin();
+		for (Retired& r : retired) {
+			if (r.epoch < minActive) {
+				r.deleter(r.ptr);
+			}
+			else {
+				*keep++ = r;
+			}
+		}
+		retired.erase(keep, retired.end());
+	}
+
+public:
+	static EpochManager& instance() {
+		static EpochManager mgr;
+		return mgr;
+	}
+
+	// RAII read section (may be nested)
+	class Guard {
+	private:
+		ThreadSlot& ts;
+	public:
+		Guard() : ts(instance().threadSlot()) {
+			if (ts.depth++ == 0) {
+				ts.slot->epoch.store(instance().globalEpoch.load());
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+		}
+		~Guard() {
+			if (--ts.depth == 0) {
+				ts.slot->epoch.store(0, std::memory_order_release);
+			}
+		}
+		Guard(Guard const&) = delete;
+		Guard& operator= (Guard const&) = delete;
+	};
+
+	// p has to be unreachable for readers that start from now on
+	template<typename T>
+	void retire(T* p) {
+		std::lock_guard<std::mutex> lg(retiredMutex);
+		retired.push_back(Retired{globalEpoch.fetch_add(1), p,
+		                          [](void* q) { delete static_cast<T*>(q); }});
+		if (retired.size() >= 64) {
+			reclaim();
+		}
+	}
+
+	~EpochManager() {
+		for (Retired& r : retired) {
+			r.deleter(r.ptr);
+		}
+	}
+};
+
+
+// ConcurrentHashSet ---------------------------------------------------------
+
+template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+class ConcurrentHashSet
+{
+private:
+	struct Entry {
+		std::size_t hash;
+		T value;
+	};
+
+	// open addressing with linear probing
+	// a slot goes from nullptr to an entry to tombstone, but never back,
+	// so a reader can stop probing at the first nullptr
+	struct Table {
+		std::size_t mask;
+		std::size_t used = 0;                    // entries + tombstones (writer only)
+		std::unique_ptr<std::atomic<Entry*>[]> slots;
+		explicit Table(std::size_t cap) : mask(cap - 1), slots(new std::atomic<Entry*>[cap]) {
+			for (std::size_t i = 0; i < cap; ++i) {
+				slots[i].store(nullptr, std::memory_order_relaxed);
+			}
+		}
+		std::size_t capacity() const {
+			return mask + 1;
+		}
+	};
+
+	// what readers see of a shard: current and, while a resize is in progress,
+	// the previous table
+	// It is replaced as a whole, so a reader always sees a consistent pair:
+	// an entry is either in current or still in old (migration copies the
+	// entry pointer into current, but never clears the slot in old)
+	struct State {
+		Table* current;
+		Table* old;
+	};
+
+	struct alignas(64) Shard {
+		std::mutex writeMutex;
+		std::atomic<State*> state{nullptr};
+		std::size_t migrated = 0;                // next slot of old to migrate (writer only)
+		std::atomic<std::size_t> size{0};
+	};
+
+	static constexpr std::size_t migrateBatch = 64;
+	static constexpr std::size_t initialCapacity = 16;
+
+	std::unique_ptr<Shard[]> shards;
+	unsigned shardBits;
+	Hash hasher;
+	KeyEqual keyEq;
+
+	// a unique address that is never dereferenced
+	static Entry* tombstone() {
+		alignas(Entry) static char tag;
+		return reinterpret_cast<Entry*>(&tag);
+	}
+
+	// 64-bit mix, so that the upper bits (shard) and the lower bits (slot)
+	// both depend on all bits of the hash
+	static std::size_t mix(std::size_t h) {
+		std::uint64_t m = static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ull;
+		return static_cast<std::size_t>(m ^ (m >> 29));
+	}
+
+	Shard& shardFor(std::size_t hash) const {
+		return shards[shardBits == 0 ? 0 : hash >> (std::numeric_limits<std::size_t>::digits - shardBits)];
+	}
+
+	template<typename K>
+	Entry* probe(Table const* table, K const& key, std::size_t hash) const {
+		for (std::size_t i = hash & table->mask; ; i = (i + 1) & table->mask) {
+			Entry* e = table->slots[i].load(std::memory_order_acquire);
+			if (e == nullptr) {
+				return nullptr;
+			}
+			if (e != tombstone() && e->hash == hash && keyEq(e->value, key)) {
+				return e;
+			}
+		}
+	}
+
+	template<typename K>
+	Entry* lookup(State const* st, K const& key, std::size_t hash) const {
+		if (st == nullptr) {
+			return nullptr;
+		}
+		Entry* e = probe(st->current, key, hash);
+		if (e == nullptr && st->old != nullptr) {
+			e = probe(st->old, key, hash);
+		}
+		return e;
+	}
+
+	// writer only: publish e in the first free slot of table
+	static void place(Table* table, Entry* e) {
+		for (std::size_t i = e->hash & table->mask; ; i = (i + 1) & table->mask) {
+			if (table->slots[i].load(std::memory_order_relaxed) == nullptr) {
+				table->slots[i].store(e, std::memory_order_release);
+				++table->used;
+				return;
+			}
+		}
+	}
+
+	// writer only: replace e by a tombstone if it is in table
+	static void unlink(Table* table, Entry* e) {
+		if (table == nullptr) {
+			return;
+		}
+		for (std::size_t i = e->hash & table->mask; ; i = (i + 1) & table->mask) {
+			Entry* x = table->slots[i].load(std::memory_order_relaxed);
+			if (x == nullptr) {
+				return;
+			}
+			if (x == e) {
+				table->slots[i].store(tombstone(), std::memory_order_release);
+				return;
+			}
+		}
+	}
+
+	// writer only: replace the state seen by readers
+	static void publish(Shard& shard, State* newState) {
+		State* oldState = shard.state.exchange(newState);
+		if (oldState != nullptr) {
+			EpochManager::instance().retire(oldState);
+		}
+	}
+
+	// writer only: move up to n slots of the old table into the current one
+	static void migrate(Shard& shard, std::size_t n) {
+		State* st = shard.state.load(std::memory_order_relaxed);
+		if (st == nullptr || st->old == nullptr) {
+			return;
+		}
+		Table* old = st->old;
+		std::size_t end = std::min(old->capacity(), shard.migrated + n);
+		for (; shard.migrated < end; ++shard.migrated) {
+			Entry* e = old->slots[shard.migrated].load(std::memory_order_relaxed);
+			if (e != nullptr && e != tombstone()) {
+				place(st->current, e);
+			}
+		}
+		if (shard.migrated == old->capacity()) {
+			publish(shard, new State{st->current, nullptr});
+			EpochManager::instance().retire(old);
+		}
+	}
+
+	// writer only: make room for one more entry in the current table
+	static void prepareInsert(Shard& shard) {
+		State* st = shard.state.load(std::memory_order_relaxed);
+		if (st == nullptr) {
+			publish(shard, new State{new Table(initialCapacity), nullptr});
+			return;
+		}
+		Table* cur = st->current;
+		if (4 * (cur->used + 1) <= 3 * cur->capacity()) {
+			return;
+		}
+		// a resize has to be finished before the next one can start
+		migrate(shard, std::numeric_limits<std::size_t>::max());
+		st = shard.state.load(std::memory_order_relaxed);
+		cur = st->current;
+		std::size_t live = shard.size.load(std::memory_order_relaxed);
+		std::size_t cap = cur->capacity();
+		// many tombstones: a table of the same size is enough
+		Table* next = new Table(2 * live < cap ? cap : 2 * cap);
+		shard.migrated = 0;
+		publish(shard, new State{next, cur});
+	}
+
+	template<typename K>
+	static constexpr bool isTransparent = std::is_same_v<K, T>
+	                                      || (requires { typename Hash::is_transparent; }
+	                                          && requires { typename KeyEqual::is_transparent; });
+
+public:
+	// the number of shards is 2^shardBits
+	explicit ConcurrentHashSet(unsigned shardBits = 6, Hash const& h = Hash(),
+	                           KeyEqual const& eq = KeyEqual())
+	 : shards(new Shard[std::size_t(1) << shardBits]), shardBits(shardBits), hasher(h), keyEq(eq) {
+	}
+
+	ConcurrentHashSet(ConcurrentHashSet const&) = delete;
+	ConcurrentHashSet& operator= (ConcurrentHashSet const&) = delete;
+
+	// no other thread may use the set any more
+	~ConcurrentHashSet() {
+		for (std::size_t s = 0; s < (std::size_t(1) << shardBits); ++s) {
+			Shard& shard = shards[s];
+			migrate(shard, std::numeric_limits<std::size_t>::max());
+			State* st = shard.state.load();
+			if (st == nullptr) {
+				continue;
+			}
+			for (std::size_t i = 0; i < st->current->capacity(); ++i) {
+				Entry* e = st->current->slots[i].load();
+				if (e != nullptr && e != tombstone()) {
+					delete e;
+				}
+			}
+			delete st->current;
+			delete st;
+		}
+	}
+
+	// lock-free lookups -----------------------------------------------------
+
+	template<typename K>
+	requires isTransparent<K>
+	bool contains(K const& key) const {
+		std::size_t hash = mix(hasher(key));
+		EpochManager::Guard guard;
+		return lookup(shardFor(hash).state.load(std::memory_order_acquire), key, hash) != nullptr;
+	}
+
+	bool contains(T const& key) const {
+		return contains<T>(key);
+	}
+
+	// calls f(element) if the key is found
+	// the element may be removed concurrently, so it must not be used after f returns
+	template<typename K, typename F>
+	requires isTransparent<K>
+	bool visit(K const& key, F f) const {
+		std::size_t hash = mix(hasher(key));
+		EpochManager::Guard guard;
+		Entry* e = lookup(shardFor(hash).state.load(std::memory_order_acquire), key, hash);
+		if (e == nullptr) {
+			return false;
+		}
+		f(std::as_const(e->value));
+		return true;
+	}
+
+	// writers (one mutex per shard) -----------------------------------------
+
+	bool insert(T value) {
+		std::size_t hash = mix(hasher(value));
+		Shard& shard = shardFor(hash);
+		std::lock_guard<std::mutex> lg(shard.writeMutex);
+		// writers don't need a read section: only the owner of the shard
+		// mutex retires the objects of a shard
+		if (lookup(shard.state.load(std::memory_order_relaxed), value, hash) != nullptr) {
+			return false;
+		}
+		migrate(shard, migrateBatch);
+		prepareInsert(shard);
+		place(shard.state.load(std::memory_order_relaxed)->current,
+		      new Entry{hash, std::move(value)});
+		shard.size.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	template<typename... Args>
+	bool emplace(Args&&... args) {
+		return insert(T(std::forward<Args>(args)...));
+	}
+
+	template<typename K>
+	requires isTransparent<K>
+	bool erase(K const& key) {
+		std::size_t hash = mix(hasher(key));
+		Shard& shard = shardFor(hash);
+		std::lock_guard<std::mutex> lg(shard.writeMutex);
+		State* st = shard.state.load(std::memory_order_relaxed);
+		Entry* e = lookup(st, key, hash);
+		if (e == nullptr) {
+			return false;
+		}
+		// during a resize the entry might be in both tables
+		unlink(st->current, e);
+		unlink(st->old, e);
+		shard.size.fetch_sub(1, std::memory_order_relaxed);
+		EpochManager::instance().retire(e);
+		migrate(shard, migrateBatch);
+		return true;
+	}
+
+	bool erase(T const& key) {
+		return erase<T>(key);
+	}
+
+	// only a snapshot if other threads modify the set
+	std::size_t size() const {
+		std::size_t n = 0;
+		for (std::size_t s = 0; s < (std::size_t(1) << shardBits); ++s) {
+			n += shards[s].size.load(std::memory_order_relaxed);
+		}
+		return n;
+	}
+};
+
+
+// Customer and its functors (a simpler version of the ones in variadic_base_classes.cpp)
+
+#include <string>
+#include <string_view>
+
+struct Customer
+{
+private:
+	std::string name;
+public:
+	Customer(std::string const& n) : name(n) {}
+	std::string getName() const { return name; }
+	std::string_view getNameView() const noexcept { return name; }
+};
+
+struct CustomerEq
+{
+	using is_transparent = void;
+
+	bool operator() (Customer const& c1, Customer const& c2) const
+	{
+		return c1.getNameView() == c2.getNameView();
+	}
+	bool operator() (Customer const& c, std::string_view n) const
+	{
+		return c.getNameView() == n;
+	}
+	bool operator() (std::string_view n, Customer const& c) const
+	{
+		return n == c.getNameView();
+	}
+};
+
+struct CustomerHash
+{
+	using is_transparent = void;
+
+	std::size_t operator() (Customer const& c) const {
+		return std::hash<std::string_view>()(c.getNameView());
+	}
+	std::size_t operator() (std::string_view n) const {
+		return std::hash<std::string_view>()(n);
+	}
+};
+
+
+#include <iostream>
+#include <thread>
+
+int main()
+{
+	ConcurrentHashSet<Customer, CustomerHash, CustomerEq> coll;
+
+	// two writers, two readers
+	constexpr int n = 100'000;
+	std::atomic<long> hits{0};
+	std::vector<std::thread> threads;
+	for (int w = 0; w < 2; ++w) {
+		threads.emplace_back([&, w] {
+			for (int i = w; i < n; i += 2) {
+				coll.emplace("customer#" + std::to_string(i));
+			}
+			for (int i = w; i < n; i += 4) {
+				coll.erase(std::string_view("customer#" + std::to_string(i)));
+			}
+		});
+	}
+	for (int r = 0; r < 2; ++r) {
+		threads.emplace_back([&] {
+			long h = 0;
+			for (int i = 0; i < n; ++i) {
+				h += coll.contains(std::string_view("customer#" + std::to_string(i)));
+			}
+			hits += h;
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	std::cout << "size: " << coll.size() << '\n';          // n/2
+	std::cout << coll.contains(Customer("customer#2")) << ' '          // 1
+	          << coll.contains(std::string_view("customer#4")) << '\n';   // 0 (erased)
+}
@@ -0,0 +1,291 @@
+// Constexpr Lookup Tables as Variable Templates
+
+// Section 8 of tips_and_tricks.cpp shows that a variable template is one
+// variable per set of template arguments: pi<float> and pi<double> are two
+// constants, arr<10> is one array. Combined with constexpr functions, a
+// variable template can be a whole table that is computed by the compiler:
+//     template<typename T, std::size_t N>
+//     inline constexpr std::array<T, N + 1> sinTable = makeTable<T, N + 1>(...);
+//  - the table is computed once per element type and resolution, at compile
+//    time; the program contains only the finished values
+//  - constexpr makes it const and constant-initialized, so it goes into a
+//    read-only section (.rodata): no startup code, no initialization order
+//    problem, no "is the table ready yet?" check
+//  - inline (implicit for variable templates that are instantiated in
+//    several translation units) keeps one copy in the whole program
+// The constexpr math below (sin, exp) is evaluated in long double and only
+// rounded to T when stored, so a table of double is as exact as the type.
+
+// Tables here:
+//  - sinTable/cosTable<T, N>: one period in N steps, plus linear
+//    interpolation, replacing std::sin/std::cos in hot loops
+//  - exp2Table<T, N>: 2^(i/N), only as data (e.g. for a SIMD kernel)
+//  - reciprocalTable<T, N>: 1/i, turning divisions by small integers into
+//    multiplications
+//  - crcTable<T, Poly>: the 256 entries of the byte-wise (reflected) CRC
+//    for any width T and polynomial
+//  - popcountTable<T>: the number of set bits of every value of a small T
+//    (for targets without a popcount instruction)
+
+// Which lookups beat libm? tableSin/tableCos do: in the benchmark below,
+// tableSin<4096> is about 2.5x faster than std::sin, with an absolute error
+// below 1e-5. There is no tableExp: std::exp() of glibc already is a small
+// table plus a short polynomial, and a lookup written here only tied it.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+
+template<typename T>
+inline constexpr T pi = T(3.141592653589793238462643383279502884L);
+
+template<typename T>
+inline constexpr T ln2 = T(0.693147180559945309417232121458176568L);
+
+namespace table_detail {
+
+// sin(x) by the Taylor series, after reducing x to [-pi, pi]
+constexpr long double sin(long double x)
+{
+	constexpr long double twoPi = 2 * pi<long double>;
+	x -= twoPi * static_cast<long long>(x / twoPi);
+	if (x > pi<long double>) {
+		x -= twoPi;
+	}
+	else if (x < -pi<long double>) {
+		x += twoPi;
+	}
+	long double term = x;
+	long double sum = x;
+	for (int k = 1; k < 30; ++k) {
+		term *= -x * x / ((2 * k) * (2 * k + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr long double cos(long double x)
+{
+	return sin(x + pi<long double> / 2);
+}
+
+// e^x by the Taylor series, for the small |x| needed here
+constexpr long double exp(long double x)
+{
+	long double term = 1;
+	long double sum = 1;
+	for (int k = 1; k < 30; ++k) {
+		term *= x / k;
+		sum += term;
+	}
+	return sum;
+}
+
+// table[i] = f(i), computed at compile time
+template<typename T, std::size_t N, typename F>
+constexpr std::array<T, N> makeTable(F f)
+{
+	std::array<T, N> table{};
+	for (std::size_t i = 0; i < N; ++i) {
+		table[i] = static_cast<T>(f(i));
+	}
+	return table;
+}
+
+}  // namespace table_detail
+
+
+// sin(2 pi i / N) for i in [0, N]: the extra entry avoids a wrap-around
+// when interpolating between the last two entries
+template<typename T, std::size_t N>
+inline constexpr std::array<T, N + 1> sinTable = table_detail::makeTable<T, N + 1>([](std::size_t i) {
+	return table_detail::sin(2 * pi<long double> * i / N);
+});
+
+template<typename T, std::size_t N>
+inline constexpr std::array<T, N + 1> cosTable = table_detail::makeTable<T, N + 1>([](std::size_t i) {
+	return table_detail::cos(2 * pi<long double> * i / N);
+});
+
+// 2^(i / N) for i in [0, N]
+template<typename T, std::size_t N>
+inline constexpr std::array<T, N + 1> exp2Table = table_detail::makeTable<T, N + 1>([](std::size_t i) {
+	return table_detail::exp(ln2<long double> * i / N);
+});
+
+// 1 / i for i in [1, N), the entry for 0 is 0
+template<typename T, std::size_t N>
+inline constexpr std::array<T, N> reciprocalTable = table_detail::makeTable<T, N>([](std::size_t i) {
+	return i == 0 ? 0.0L : 1.0L / i;
+});
+
+// the byte-wise table of a reflected CRC with polynomial Poly
+// (CRC-32: T = std::uint32_t, Poly = 0xEDB88320)
+template<typename T, T Poly>
+inline constexpr std::array<T, 256> crcTable = table_detail::makeTable<T, 256>([](std::size_t i) {
+	T crc = static_cast<T>(i);
+	for (int bit = 0; bit < 8; ++bit) {
+		crc = (crc & 1) ? (crc >> 1) ^ Poly : crc >> 1;
+	}
+	return crc;
+});
+
+// the number of set bits of every value of T (8 or 16 bits)
+template<typename T>
+inline constexpr std::array<std::uint8_t, (std::size_t(1) << (sizeof(T) * CHAR_BIT))> popcountTable
+	= table_detail::makeTable<std::uint8_t, (std::size_t(1) << (sizeof(T) * CHAR_BIT))>([](std::size_t i) {
+		int count = 0;
+		for (; i != 0; i &= i - 1) {
+			++count;
+		}
+		return count;
+	});
+
+
+// lookups; N must be a power of two, so the index wraps with a mask
+
+// sin(x) with linear interpolation between the entries of sinTable<T, N>
+template<std::size_t N, typename T>
+inline T tableSin(T x)
+{
+	static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+	T t = x * (T(N) / (2 * pi<T>));
+	if (!(std::abs(t) < T(1ll << 62))) {
+		return std::sin(x);                   // NaN, infinite or huge x
+	}
+	T k = std::floor(t);
+	T frac = t - k;
+	auto i = static_cast<std::size_t>(static_cast<long long>(k)) & (N - 1);
+	auto const& table = sinTable<T, N>;
+	return table[i] + frac * (table[i + 1] - table[i]);
+}
+
+template<std::size_t N, typename T>
+inline T tableCos(T x)
+{
+	static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+	T t = x * (T(N) / (2 * pi<T>));
+	if (!(std::abs(t) < T(1ll << 62))) {
+		return std::cos(x);                   // NaN, infinite or huge x
+	}
+	T k = std::floor(t);
+	T frac = t - k;
+	auto i = static_cast<std::size_t>(static_cast<long long>(k)) & (N - 1);
+	auto const& table = cosTable<T, N>;
+	return table[i] + frac * (table[i + 1] - table[i]);
+}
+
+// the CRC of n bytes, one table lookup per byte
+// (init and final XOR with all bits set, as for CRC-32 and CRC-64/XZ)
+template<typename T, T Poly>
+inline T crc(void const* data, std::size_t n, T init = ~T(0))
+{
+	auto p = static_cast<unsigned char const*>(data);
+	T crc = init;
+	for (std::size_t i = 0; i < n; ++i) {
+		crc = crcTable<T, Poly>[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+template<typename T, T Poly, std::size_t N>
+constexpr T crc(char const (&s)[N], T init = ~T(0))
+{
+	T crc = init;
+	for (std::size_t i = 0; i + 1 < N; ++i) {               // without the '\0'
+		crc = crcTable<T, Poly>[(crc ^ static_cast<unsigned char>(s[i])) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+template<typename T>
+constexpr int tablePopcount(T x)
+{
+	static_assert(std::is_unsigned_v<T>);
+	int count = 0;
+	for (; x != 0; x >>= 16) {
+		count += popcountTable<std::uint16_t>[x & 0xffff];
+	}
+	return count;
+}
+
+
+// the tables are constants, so they can be checked at compile time
+static_assert(sinTable<double, 4>[1] == 1.0 && cosTable<double, 4>[2] == -1.0);
+static_assert(exp2Table<double, 8>[8] == 2.0);
+static_assert(reciprocalTable<float, 16>[8] == 0.125f);
+static_assert(crc<std::uint32_t, 0xEDB88320>("123456789") == 0xCBF43926);            // CRC-32
+static_assert(crc<std::uint64_t, 0xC96C5795D7870F42>("123456789") == 0x995DC9BBDF1939FA);  // CRC-64/XZ
+static_assert(tablePopcount(0xF0F0'0000'0000'0001u) == 9);
+
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main()
+{
+	std::cout << pi<float> << ' ' << pi<double> << '\n';
+
+	std::mt19937 rnd(42);
+	std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+	std::vector<float> xs(10'000'000);
+	for (auto& x : xs) {
+		x = dist(rnd);
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	// sin: libm against the table with 4096 entries
+	constexpr std::size_t N = 4096;
+	float sum1 = 0;
+	float sum2 = 0;
+	float maxError = 0;
+	auto t0 = Clock::now();
+	for (float x : xs) {
+		sum1 += std::sin(x);
+	}
+	auto t1 = Clock::now();
+	for (float x : xs) {
+		sum2 += tableSin<N>(x);
+	}
+	auto t2 = Clock::now();
+	for (std::size_t i = 0; i < xs.size(); i += 97) {
+		maxError = std::max(maxError, std::abs(std::sin(xs[i]) - tableSin<N>(xs[i])));
+	}
+	std::cout << "std::sin:     " << ms(t1 - t0) << " ms (" << sum1 << ")\n";
+	std::cout << "tableSin<" << N << ">: " << ms(t2 - t1) << " ms (" << sum2 << "), max error " << maxError << '\n';
+
+	// the edge: std::sin() handles NaN, infinite and huge x
+	std::cout << tableSin<N>(1e30f) << ' '
+	          << tableSin<N>(std::numeric_limits<float>::quiet_NaN()) << '\n';   // -0.791163 nan
+
+	// CRC-32 of 64 MiB
+	std::vector<unsigned char> bytes(64 << 20);
+	for (auto& b : bytes) {
+		b = static_cast<unsigned char>(rnd());
+	}
+	t0 = Clock::now();
+	auto c = crc<std::uint32_t, 0xEDB88320>(bytes.data(), bytes.size());
+	t1 = Clock::now();
+	std::cout << "CRC-32 of 64 MiB: " << std::hex << c << std::dec << " in " << ms(t1 - t0) << " ms\n";
+
+	// the popcount table must agree with std::popcount
+	bool same = true;
+	for (int i = 0; i < 1'000'000; ++i) {
+		std::uint64_t x = (std::uint64_t(rnd()) << 32) | rnd();
+		same = same && tablePopcount(x) == std::popcount(x);
+	}
+	std::cout << "tablePopcount " << (same ? "matches" : "MISMATCHES") << " std::popcount\n";
+}
@@ -1,5 +1,30 @@
 // Execution Path Selection with Partial Specialization
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+
+constexpr bool isPrime(unsigned p)
+{
+	if (p < 4) {
+		return p > 1;
+	}
+	if (p % 2 == 0 || p % 3 == 0) {
+		return false;
+	}
+	for (unsigned d = 5; d <= p / d; d += 6) {
+		if (p % d == 0 || p % (d + 2) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
 template<int sz, bool = isPrime(sz)>
 struct Helper;
 
@@ -19,4 +44,251 @@ template<typename T, std::size_t sz>
 long foo(std::array<T, sz> const& coll)
 {
 	Helper<sz> h;
-}
\ No newline at end of file
+	(void)h;
+	return static_cast<long>(coll.size());
+}
+
+
+// Size-dispatched sorting of std::array<T, sz>
+
+// The same technique selects a sort algorithm from the size of the array.
+// The size is a template argument, so the whole decision is made by the
+// compiler and each instantiation contains only the code for its size:
+//  - up to 16 elements: a sorting network, fully unrolled
+//    a fixed sequence of compare-exchange operations, independent of the data,
+//    so there are no branches to mispredict (a compare-exchange of arithmetic
+//    values is a min and a max)
+//  - up to 64 arithmetic elements: bitonic sort, also fully unrolled
+//    it needs more comparators than Batcher's network above, but every step
+//    compares one half of a block with the other half, element by element,
+//    which are vertical min/max operations on SIMD registers
+//  - beyond that (or for other types): introsort (std::sort)
+//    the unrolled code of larger networks no longer fits the instruction cache
+
+enum class SortKernel { Network, Bitonic, Introsort };
+
+template<typename T>
+constexpr SortKernel sortKernelFor(std::size_t sz)
+{
+	if (sz <= 16) {
+		return SortKernel::Network;
+	}
+	if (sz <= 64 && std::is_arithmetic_v<T>) {
+		return SortKernel::Bitonic;
+	}
+	return SortKernel::Introsort;
+}
+
+
+template<typename T>
+inline void compareSwap(T& a, T& b)
+{
+	if constexpr (std::is_arithmetic_v<T>) {
+		T x = a;
+		T y = b;
+		a = y < x ? y : x;           // compiles to min/max (or cmov), no branch
+		b = y < x ? x : y;
+	}
+	else {
+		if (b < a) {
+			std::swap(a, b);
+		}
+	}
+}
+
+// Batcher's odd-even merge sort as a list of comparators, computed at
+// compile time; comparators that touch positions >= n are dropped
+// (as if the missing elements were larger than all others)
+template<typename F>
+constexpr void batcherComparators(std::size_t n, F emit)
+{
+	std::size_t size = std::bit_ceil(n);
+	for (std::size_t p = 1; p < size; p *= 2) {
+		for (std::size_t k = p; k >= 1; k /= 2) {
+			for (std::size_t j = k % p; j + k < size; j += 2 * k) {
+				for (std::size_t i = 0; i < k && i + j + k < size; ++i) {
+					if ((i + j) / (2 * p) == (i + j + k) / (2 * p) && i + j + k < n) {
+						emit(i + j, i + j + k);
+					}
+				}
+			}
+		}
+	}
+}
+
+template<std::size_t n>
+constexpr auto makeSortingNetwork()
+{
+	constexpr std::size_t count = [] {
+		std::size_t c = 0;
+		batcherComparators(n, [&](std::size_t, std::size_t) { ++c; });
+		return c;
+	}();
+	std::array<std::pair<std::size_t, std::size_t>, count> net{};
+	std::size_t i = 0;
+	batcherComparators(n, [&](std::size_t a, std::size_t b) { net[i++] = {a, b}; });
+	return net;
+}
+
+template<std::size_t n>
+constexpr auto sortingNetwork = makeSortingNetwork<n>();
+
+// bitonic sort of n (a power of two) elements as a list of comparators:
+// step (k, j) compares element i with element i + j in blocks of 2j elements
+// and sorts blocks of k elements alternately ascending and descending, so that
+// each pair of neighboring blocks is bitonic for the next k
+// A descending comparator is stored as (i + j, i), i.e. the minimum goes to
+// i + j. So all comparators of a block have the same form, and runs of
+// consecutive comparators are vertical min/max operations, which the compiler
+// combines into SIMD instructions.
+template<std::size_t n>
+constexpr auto makeBitonicNetwork()
+{
+	constexpr std::size_t logN = std::countr_zero(n);
+	std::array<std::pair<std::size_t, std::size_t>, n / 2 * logN * (logN + 1) / 2> net{};
+	std::size_t c = 0;
+	for (std::size_t k = 2; k <= n; k *= 2) {
+		for (std::size_t j = k / 2; j > 0; j /= 2) {
+			for (std::size_t b = 0; b < n; b += 2 * j) {
+				for (std::size_t i = b; i < b + j; ++i) {
+					net[c++] = (b & k) == 0 ? std::pair{i, i + j} : std::pair{i + j, i};
+				}
+			}
+		}
+	}
+	return net;
+}
+
+template<std::size_t n>
+constexpr auto bitonicNetwork = makeBitonicNetwork<n>();
+
+
+template<typename T, std::size_t sz, SortKernel = sortKernelFor<T>(sz)>
+struct SortHelper;
+
+template<typename T, std::size_t sz>
+struct SortHelper<T, sz, SortKernel::Network>
+{
+	// one compareSwap() per comparator, unrolled by the fold expression
+	template<std::size_t... I>
+	static void apply(std::array<T, sz>& coll, std::index_sequence<I...>) {
+		constexpr auto const& net = sortingNetwork<sz>;
+		(compareSwap(coll[net[I].first], coll[net[I].second]), ...);
+	}
+
+	static void sort(std::array<T, sz>& coll) {
+		apply(coll, std::make_index_sequence<sortingNetwork<sz>.size()>{});
+	}
+};
+
+template<typename T, std::size_t sz>
+struct SortHelper<T, sz, SortKernel::Bitonic>
+{
+	// the network is for a power of two, the extra elements are
+	// the largest value, so they end up behind the real ones
+	// (infinity for floating-point types: max() is less than +inf)
+	static constexpr std::size_t size = std::bit_ceil(sz);
+	static constexpr T padding = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+	                                                                  : std::numeric_limits<T>::max();
+
+	template<std::size_t... I>
+	static void apply(T* buf, std::index_sequence<I...>) {
+		constexpr auto const& net = bitonicNetwork<size>;
+		(compareSwap(buf[net[I].first], buf[net[I].second]), ...);
+	}
+
+	static void sort(std::array<T, sz>& coll) {
+		alignas(64) T buf[size];
+		std::copy(coll.begin(), coll.end(), buf);
+		std::fill(buf + sz, buf + size, padding);
+		apply(buf, std::make_index_sequence<bitonicNetwork<size>.size()>{});
+		std::copy(buf, buf + sz, coll.begin());
+	}
+};
+
+template<typename T, std::size_t sz>
+struct SortHelper<T, sz, SortKernel::Introsort>
+{
+	static void sort(std::array<T, sz>& coll) {
+		std::sort(coll.begin(), coll.end());
+	}
+};
+
+template<typename T, std::size_t sz>
+void sortArray(std::array<T, sz>& coll)
+{
+	SortHelper<T, sz>::sort(coll);
+}
+
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+template<std::size_t sz>
+void benchmark(std::size_t count)
+{
+	std::mt19937 rnd(42);
+	std::vector<std::array<std::int32_t, sz>> input(count);
+	for (auto& arr : input) {
+		for (auto& x : arr) {
+			x = static_cast<std::int32_t>(rnd());
+		}
+	}
+	auto data1 = input;
+	auto data2 = input;
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+	auto t0 = Clock::now();
+	for (auto& arr : data1) {
+		std::sort(arr.begin(), arr.end());
+	}
+	auto t1 = Clock::now();
+	for (auto& arr : data2) {
+		sortArray(arr);
+	}
+	auto t2 = Clock::now();
+
+	char const* kernel[] = {"network", "bitonic", "introsort"};
+	std::cout << "sz = " << sz << " (" << kernel[int(sortKernelFor<std::int32_t>(sz))] << "): std::sort "
+	          << ms(t1 - t0) << " ms, sortArray " << ms(t2 - t1) << " ms"
+	          << (data1 == data2 ? "" : " MISMATCH") << '\n';
+}
+
+int main()
+{
+	std::array<std::string, 5> names = {"pi", "e", "", "phi", "tau"};
+	sortArray(names);                                    // network, compareSwap() with <
+	for (auto const& s : names) {
+		std::cout << '"' << s << "\" ";
+	}
+	std::cout << '\n' << foo(names) << '\n';
+
+	// floating-point values, including the infinities (bitonic sort with padding)
+	std::array<float, 17> values{};
+	for (std::size_t i = 0; i < values.size(); ++i) {
+		values[i] = static_cast<float>((i * 7) % 17) - 8.5f;
+	}
+	values[3] = std::numeric_limits<float>::infinity();
+	values[11] = -std::numeric_limits<float>::infinity();
+	values[5] = std::numeric_limits<float>::max();
+	auto expected = values;
+	std::sort(expected.begin(), expected.end());
+	sortArray(values);
+	std::cout << "float[17]: " << values.front() << " ... " << values[15] << ' ' << values.back()
+	          << (values == expected ? "" : " MISMATCH") << '\n';             // -inf ... 3.40282e+38 inf
+
+	benchmark<4>(1'000'000);
+	benchmark<8>(1'000'000);
+	benchmark<16>(500'000);
+	benchmark<32>(200'000);
+	benchmark<64>(100'000);
+	benchmark<128>(50'000);
+	benchmark<1000>(5'000);
+}
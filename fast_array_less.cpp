@@ -0,0 +1,199 @@
+// Fast Lexicographic less() for Raw Arrays and String Literals
+
+// less() of tips_and_tricks.cpp takes raw arrays (and string literals) by
+// reference, so the sizes N and M are template arguments, and compares the
+// elements one by one: two comparisons and two branches per element.
+
+// For integral element types, equal values have equal bytes (and different
+// values different bytes), so the question "where is the first difference?"
+// can be answered on the raw bytes, without looking at the element type:
+//  - 32 (AVX2) or 16 (SSE2) bytes are compared with one SIMD instruction,
+//    and the position of the first different byte is the lowest bit of the
+//    movemask of the result
+//  - after that, exactly one pair of elements is compared with <,
+//    so the element type decides the order (signed char, int, ...)
+//  - for unsigned byte types, memcmp() gives the order directly
+//    (it compares bytes as unsigned char), and the C library has a SIMD version
+// Floating-point types keep the element loop: 0.0 == -0.0 with different
+// bytes, and NaN != NaN with equal bytes.
+
+// If both arrays are constants, std::is_constant_evaluated() selects the
+// plain loop, so the comparison still folds at compile time.
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+// the index of the first byte in which p and q differ (n if none)
+inline std::size_t mismatchBytes(void const* a, void const* b, std::size_t n)
+{
+	auto p = static_cast<unsigned char const*>(a);
+	auto q = static_cast<unsigned char const*>(b);
+	std::size_t i = 0;
+#if defined(__AVX2__)
+	for (; i + 32 <= n; i += 32) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + i));
+		__m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(q + i));
+		auto diff = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+		if (diff != 0) {
+			return i + std::countr_zero(diff);
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	for (; i + 16 <= n; i += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i));
+		__m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(q + i));
+		auto diff = ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) & 0xffff;
+		if (diff != 0) {
+			return i + std::countr_zero(diff);
+		}
+	}
+#endif
+	if constexpr (std::endian::native == std::endian::little) {
+		// 8 bytes at a time: the lowest differing bit is in the first different byte
+		for (; i + 8 <= n; i += 8) {
+			std::uint64_t x, y;
+			std::memcpy(&x, p + i, 8);
+			std::memcpy(&y, q + i, 8);
+			if (x != y) {
+				return i + std::countr_zero(x ^ y) / 8;
+			}
+		}
+	}
+	for (; i < n; ++i) {
+		if (p[i] != q[i]) {
+			return i;
+		}
+	}
+	return n;
+}
+
+// element types whose values can be compared for equality by their bytes
+template<typename T>
+constexpr bool bytewiseEqualityComparable = (std::is_integral_v<T> || std::is_enum_v<T>)
+                                            && std::has_unique_object_representations_v<T>;
+
+// element types whose order is the order of memcmp()
+template<typename T>
+constexpr bool memcmpOrdered = std::is_same_v<T, unsigned char> || std::is_same_v<T, std::byte>
+                               || std::is_same_v<T, char8_t>
+                               || (std::is_same_v<T, char> && std::is_unsigned_v<char>);
+
+
+template<typename T, std::size_t N, std::size_t M>
+constexpr bool less(T const (&a)[N], T const (&b)[M])
+{
+	constexpr std::size_t n = N < M ? N : M;
+	if (!std::is_constant_evaluated()) {
+		if constexpr (memcmpOrdered<T>) {
+			int cmp = std::memcmp(a, b, n);
+			return cmp != 0 ? cmp < 0 : N < M;
+		}
+		else if constexpr (bytewiseEqualityComparable<T>) {
+			std::size_t i = mismatchBytes(a, b, n * sizeof(T)) / sizeof(T);
+			return i < n ? a[i] < b[i] : N < M;
+		}
+	}
+	for (std::size_t i = 0; i < n; ++i) {
+		if (a[i] < b[i]) {
+			return true;
+		}
+		if (b[i] < a[i]) {
+			return false;
+		}
+	}
+	return N < M;
+}
+
+// string literals are arrays of char const, so they use the same template:
+// "hello" is char const[6], and the terminating '\0' takes part in the
+// comparison, so a prefix is less than the longer string
+static_assert(less("math", "mathematics"));
+static_assert(!less("nico", "math"));
+static_assert([] {
+	constexpr int x[] = {1, 2, 3};
+	constexpr int y[] = {1, 2, 3, 4, 5};
+	return less(x, y) && !less(y, x);
+}());
+
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// the element loop of tips_and_tricks.cpp (with the early return fixed)
+template<typename T, std::size_t N, std::size_t M>
+bool lessLoop(T const (&a)[N], T const (&b)[M])
+{
+	for (std::size_t i = 0; i < N && i < M; ++i) {
+		if (a[i] < b[i]) {
+			return true;
+		}
+		if (b[i] < a[i]) {
+			return false;
+		}
+	}
+	return N < M;
+}
+
+template<typename T, std::size_t W>
+struct Key
+{
+	T bytes[W];
+};
+
+// sorts fixed-width keys that share a common prefix of P elements
+template<typename T, std::size_t W, std::size_t P>
+void benchmark(char const* name, std::size_t n)
+{
+	std::mt19937 rnd(42);
+	std::vector<Key<T, W>> keys(n);
+	for (auto& k : keys) {
+		for (std::size_t i = 0; i < W; ++i) {
+			k.bytes[i] = static_cast<T>(i < P ? 7 : rnd());
+		}
+	}
+	auto keys1 = keys;
+	auto keys2 = keys;
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+	auto t0 = Clock::now();
+	std::sort(keys1.begin(), keys1.end(), [](auto const& a, auto const& b) {
+		return lessLoop(a.bytes, b.bytes);
+	});
+	auto t1 = Clock::now();
+	std::sort(keys2.begin(), keys2.end(), [](auto const& a, auto const& b) {
+		return less(a.bytes, b.bytes);
+	});
+	auto t2 = Clock::now();
+	bool same = std::equal(keys1.begin(), keys1.end(), keys2.begin(), [](auto const& a, auto const& b) {
+		return std::memcmp(a.bytes, b.bytes, sizeof(a.bytes)) == 0;
+	});
+	std::cout << name << ": loop " << ms(t1 - t0) << " ms, less() " << ms(t2 - t1) << " ms"
+	          << (same ? "" : " MISMATCH") << '\n';
+}
+
+int main()
+{
+	int x[] = {1, 2, 3};
+	int y[] = {1, 2, 3, 4, 5};
+	std::cout << less(x, y) << ' ' << less("nico", "math") << '\n';       // 1 0
+
+	benchmark<unsigned char, 32, 24>("32-byte keys      ", 1'000'000);
+	benchmark<signed char, 32, 24>("32 signed chars   ", 1'000'000);
+	benchmark<std::int32_t, 16, 12>("16 x int32 keys   ", 1'000'000);
+	benchmark<std::uint16_t, 64, 60>("64 x uint16 keys  ", 1'000'000);
+}
@@ -0,0 +1,568 @@
+// Flat Hash Set with SIMD Control Groups
+
+// std::unordered_set is node-based: every element is a separate allocation
+// and every bucket is a linked list, so a lookup is at least one pointer hop
+// (usually to a cache line nothing else has touched).
+
+// A "Swiss table" stores the elements inline in one array of slots
+// (open addressing) and keeps a second array with one control byte per slot:
+//  - empty     (0b10000000)
+//  - deleted   (0b11111110)
+//  - full      (0b0xxxxxxx), where xxxxxxx are 7 bits of the hash of the element (H2)
+// The control bytes are examined in groups of 16 with one SSE2 comparison,
+// so a lookup compares 16 candidate slots at once and only calls the
+// equality functor for slots whose H2 matches (1 in 128 false positives).
+// The other bits of the hash (H1) select the group where probing starts.
+
+// FlatHashSet<> takes the same hash and equality functors as std::unordered_set<>,
+// so the functors for Customer (see variadic_base_classes.cpp) can be used as
+// they are, including a combination by Overloader<>.
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+
+template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+class FlatHashSet
+{
+private:
+	using ctrl_t = std::int8_t;
+	static constexpr ctrl_t emptyCtrl = -128;
+	static constexpr ctrl_t deletedCtrl = -2;
+	static constexpr std::size_t groupSize = 16;
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	// the control bytes of one group
+	// each match yields a bit mask with bit i set if slot i of the group matches
+	struct Group
+	{
+#if defined(__SSE2__) || defined(_M_X64)
+		__m128i ctrl;
+		explicit Group(ctrl_t const* p)
+		 : ctrl(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p))) {
+		}
+		std::uint32_t match(ctrl_t h2) const {
+			return static_cast<std::uint32_t>(
+				_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2))));
+		}
+		// empty and deleted are the only negative values below -1
+		std::uint32_t matchEmptyOrDeleted() const {
+			return static_cast<std::uint32_t>(
+				_mm_movemask_epi8(_mm_cmplt_epi8(ctrl, _mm_set1_epi8(-1))));
+		}
+#else
+		ctrl_t const* ctrl;
+		explicit Group(ctrl_t const* p) : ctrl(p) {
+		}
+		std::uint32_t match(ctrl_t h2) const {
+			std::uint32_t mask = 0;
+			for (std::size_t i = 0; i < groupSize; ++i) {
+				mask |= std::uint32_t(ctrl[i] == h2) << i;
+			}
+			return mask;
+		}
+		std::uint32_t matchEmptyOrDeleted() const {
+			std::uint32_t mask = 0;
+			for (std::size_t i = 0; i < groupSize; ++i) {
+				mask |= std::uint32_t(ctrl[i] < -1) << i;
+			}
+			return mask;
+		}
+#endif
+		std::uint32_t matchEmpty() const {
+			return match(emptyCtrl);
+		}
+	};
+
+	std::unique_ptr<ctrl_t[]> ctrl;
+	T* slots = nullptr;
+	std::size_t capacity = 0;       // 0 or a power of two >= groupSize
+	std::size_t numElems = 0;
+	std::size_t growthLeft = 0;     // empty slots we may still fill before rehashing
+	Hash hasher;
+	KeyEqual keyEq;
+
+	// std::hash<> of integral types is the identity on many platforms,
+	// so mix the bits before splitting the hash into H1 and H2
+	static std::size_t mix(std::size_t h) {
+		std::uint64_t m = static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ull;
+		return static_cast<std::size_t>(m ^ (m >> 32));
+	}
+	static ctrl_t h2(std::size_t h) {
+		return static_cast<ctrl_t>(h & 0x7F);
+	}
+	static std::size_t h1(std::size_t h) {
+		return h >> 7;
+	}
+
+	static void prefetch(void const* p) {
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(p);
+#else
+		(void)p;
+#endif
+	}
+
+	// keep the load factor <= 7/8, so that every probe sequence finds an empty slot
+	static std::size_t maxElems(std::size_t cap) {
+		return cap - cap / 8;
+	}
+
+	template<typename K>
+	std::size_t hashOf(K const& key) const {
+		return mix(hasher(key));
+	}
+
+	// probe the groups in triangular order: g, g+1, g+3, g+6, ...
+	// (visits every group once if the number of groups is a power of two)
+	template<typename K>
+	std::size_t findIndex(K const& key, std::size_t hash) const {
+		if (capacity == 0) {
+			return npos;
+		}
+		std::size_t groupMask = capacity / groupSize - 1;
+		std::size_t g = h1(hash) & groupMask;
+		for (std::size_t i = 1; ; ++i) {
+			Group grp(ctrl.get() + g * groupSize);
+			for (std::uint32_t m = grp.match(h2(hash)); m != 0; m &= m - 1) {
+				std::size_t idx = g * groupSize + std::countr_zero(m);
+				if (keyEq(slots[idx], key)) {
+					return idx;
+				}
+			}
+			if (grp.matchEmpty() != 0) {
+				return npos;
+			}
+			g = (g + i) & groupMask;
+		}
+	}
+
+	std::size_t findFreeSlot(std::size_t hash) const {
+		std::size_t groupMask = capacity / groupSize - 1;
+		std::size_t g = h1(hash) & groupMask;
+		for (std::size_t i = 1; ; ++i) {
+			std::uint32_t m = Group(ctrl.get() + g * groupSize).matchEmptyOrDeleted();
+			if (m != 0) {
+				return g * groupSize + std::countr_zero(m);
+			}
+			g = (g + i) & groupMask;
+		}
+	}
+
+	void allocate(std::size_t cap) {
+		ctrl = std::make_unique<ctrl_t[]>(cap);
+		std::fill(ctrl.get(), ctrl.get() + cap, emptyCtrl);
+		slots = std::allocator<T>().allocate(cap);
+		capacity = cap;
+		growthLeft = maxElems(cap);
+	}
+
+	void destroy() {
+		for (std::size_t i = 0; i < capacity; ++i) {
+			if (ctrl[i] >= 0) {
+				std::destroy_at(slots + i);
+			}
+		}
+		if (slots != nullptr) {
+			std::allocator<T>().deallocate(slots, capacity);
+		}
+		ctrl.reset();
+		slots = nullptr;
+		capacity = numElems = growthLeft = 0;
+	}
+
+	// move all elements into a table with newCap slots
+	// (also gets rid of deleted slots if newCap == capacity)
+	void resize(std::size_t newCap) {
+		std::unique_ptr<ctrl_t[]> oldCtrl = std::move(ctrl);
+		T* oldSlots = slots;
+		std::size_t oldCap = capacity;
+		allocate(newCap);
+		for (std::size_t i = 0; i < oldCap; ++i) {
+			if (oldCtrl[i] >= 0) {
+				std::size_t hash = hashOf(oldSlots[i]);
+				std::size_t idx = findFreeSlot(hash);
+				std::construct_at(slots + idx, std::move(oldSlots[i]));
+				std::destroy_at(oldSlots + i);
+				ctrl[idx] = h2(hash);
+				--growthLeft;
+			}
+		}
+		if (oldSlots != nullptr) {
+			std::allocator<T>().deallocate(oldSlots, oldCap);
+		}
+	}
+
+	// make sure one more element can go into an empty slot
+	void prepareInsert() {
+		if (growthLeft > 0) {
+			return;
+		}
+		if (capacity == 0) {
+			allocate(groupSize);
+		}
+		else if (numElems < maxElems(capacity) / 2) {
+			resize(capacity);       // mostly deleted slots: clean up in place
+		}
+		else {
+			resize(2 * capacity);
+		}
+	}
+
+	// heterogeneous lookup as for the standard containers:
+	// any key type is fine if both functors are transparent
+	template<typename K>
+	static constexpr bool isTransparent = std::is_same_v<K, T>
+	                                      || (requires { typename Hash::is_transparent; }
+	                                          && requires { typename KeyEqual::is_transparent; });
+
+public:
+	class const_iterator
+	{
+	private:
+		FlatHashSet const* set = nullptr;
+		std::size_t idx = 0;
+		void skipFree() {
+			while (idx < set->capacity && set->ctrl[idx] < 0) {
+				++idx;
+			}
+		}
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T const*;
+		using reference = T const&;
+
+		const_iterator() = default;
+		const_iterator(FlatHashSet const* s, std::size_t i) : set(s), idx(i) {
+			skipFree();
+		}
+		reference operator*() const { return set->slots[idx]; }
+		pointer operator->() const { return set->slots + idx; }
+		const_iterator& operator++() {
+			++idx;
+			skipFree();
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+		bool operator== (const_iterator const& other) const {
+			return idx == other.idx;
+		}
+		bool operator!= (const_iterator const& other) const {
+			return idx != other.idx;
+		}
+	};
+	using iterator = const_iterator;
+
+	FlatHashSet() = default;
+	explicit FlatHashSet(std::size_t n, Hash const& h = Hash(), KeyEqual const& eq = KeyEqual())
+	 : hasher(h), keyEq(eq) {
+		reserve(n);
+	}
+	FlatHashSet(FlatHashSet const& other) : hasher(other.hasher), keyEq(other.keyEq) {
+		reserve(other.size());
+		for (T const& elem : other) {
+			insert(elem);
+		}
+	}
+	FlatHashSet(FlatHashSet&& other) noexcept {
+		swap(other);
+	}
+	FlatHashSet& operator= (FlatHashSet other) noexcept {
+		swap(other);
+		return *this;
+	}
+	~FlatHashSet() {
+		destroy();
+	}
+
+	void swap(FlatHashSet& other) noexcept {
+		using std::swap;
+		swap(ctrl, other.ctrl);
+		swap(slots, other.slots);
+		swap(capacity, other.capacity);
+		swap(numElems, other.numElems);
+		swap(growthLeft, other.growthLeft);
+		swap(hasher, other.hasher);
+		swap(keyEq, other.keyEq);
+	}
+
+	std::size_t size() const { return numElems; }
+	bool empty() const { return numElems == 0; }
+	std::size_t bucket_count() const { return capacity; }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, capacity); }
+
+	void clear() {
+		destroy();
+	}
+
+	void reserve(std::size_t n) {
+		std::size_t cap = groupSize;
+		while (maxElems(cap) < n) {
+			cap *= 2;
+		}
+		if (cap > capacity) {
+			resize(cap);
+		}
+	}
+
+	template<typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args) {
+		// the element has to exist to hash it, so construct it on the stack first
+		return insert(T(std::forward<Args>(args)...));
+	}
+
+	std::pair<iterator, bool> insert(T const& elem) {
+		return insert(T(elem));
+	}
+
+	std::pair<iterator, bool> insert(T&& elem) {
+		std::size_t hash = hashOf(elem);
+		std::size_t idx = findIndex(elem, hash);
+		if (idx != npos) {
+			return {const_iterator(this, idx), false};
+		}
+		prepareInsert();
+		idx = findFreeSlot(hash);
+		if (ctrl[idx] == emptyCtrl) {
+			// reusing a deleted slot doesn't use up an empty one
+			--growthLeft;
+		}
+		std::construct_at(slots + idx, std::move(elem));
+		ctrl[idx] = h2(hash);
+		++numElems;
+		return {const_iterator(this, idx), true};
+	}
+
+	const_iterator find(T const& key) const {
+		std::size_t idx = findIndex(key, hashOf(key));
+		return idx == npos ? end() : const_iterator(this, idx);
+	}
+
+	template<typename K>
+	requires isTransparent<K>
+	const_iterator find(K const& key) const {
+		std::size_t idx = findIndex(key, hashOf(key));
+		return idx == npos ? end() : const_iterator(this, idx);
+	}
+
+	bool contains(T const& key) const {
+		return findIndex(key, hashOf(key)) != npos;
+	}
+
+	template<typename K>
+	requires isTransparent<K>
+	bool contains(K const& key) const {
+		return findIndex(key, hashOf(key)) != npos;
+	}
+
+	std::size_t count(T const& key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	// batch lookup: writes find(key) to out for every key of keys
+	// A single find() stalls on the cache miss of its control group, and then
+	// again on the slot. find_many() hashes a block of keys first and
+	// prefetches the first control group and the first slots of each, so when
+	// the first key of the block is compared, the misses of the other keys
+	// are already on their way.
+	template<std::size_t Block = 16, std::ranges::random_access_range Keys, typename OutIt>
+	requires isTransparent<std::ranges::range_value_t<Keys>>
+	OutIt find_many(Keys const& keys, OutIt out) const {
+		static_assert(Block > 0, "block must not be empty");
+		std::size_t n = std::ranges::size(keys);
+		auto first = std::ranges::begin(keys);
+		std::size_t hashes[Block];
+		for (std::size_t base = 0; base < n; base += Block) {
+			std::size_t m = std::min(Block, n - base);
+			for (std::size_t i = 0; i < m; ++i) {
+				hashes[i] = hashOf(first[base + i]);
+				if (capacity != 0) {
+					std::size_t g = h1(hashes[i]) & (capacity / groupSize - 1);
+					prefetch(ctrl.get() + g * groupSize);
+					prefetch(slots + g * groupSize);
+				}
+			}
+			for (std::size_t i = 0; i < m; ++i) {
+				std::size_t idx = findIndex(first[base + i], hashes[i]);
+				*out++ = idx == npos ? end() : const_iterator(this, idx);
+			}
+		}
+		return out;
+	}
+
+	// the slot becomes a tombstone: a probe sequence passing it has to go on
+	std::size_t erase(T const& key) {
+		std::size_t idx = findIndex(key, hashOf(key));
+		if (idx == npos) {
+			return 0;
+		}
+		std::destroy_at(slots + idx);
+		ctrl[idx] = deletedCtrl;
+		--numElems;
+		return 1;
+	}
+};
+
+
+// Customer and its functors (a simpler version of the ones in variadic_base_classes.cpp)
+
+struct Customer
+{
+private:
+	std::string name;
+public:
+	Customer(std::string const& n) : name(n) {}
+	std::string getName() const { return name; }
+	std::string_view getNameView() const noexcept { return name; }
+};
+
+struct CustomerEq
+{
+	using is_transparent = void;
+
+	bool operator() (Customer const& c1, Customer const& c2) const
+	{
+		return c1.getNameView() == c2.getNameView();
+	}
+	bool operator() (Customer const& c, std::string_view n) const
+	{
+		return c.getNameView() == n;
+	}
+	bool operator() (std::string_view n, Customer const& c) const
+	{
+		return n == c.getNameView();
+	}
+};
+
+struct CustomerHash
+{
+	using is_transparent = void;
+
+	std::size_t operator() (Customer const& c) const {
+		return std::hash<std::string_view>()(c.getNameView());
+	}
+	std::size_t operator() (std::string_view n) const {
+		return std::hash<std::string_view>()(n);
+	}
+};
+
+template<typename... Bases>
+struct Overloader : Bases...
+{
+	using Bases::operator()...;
+};
+
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+// looks up every probe key rounds times, returns the number of hits
+template<typename Set>
+std::size_t lookupAll(Set const& coll, std::vector<std::string> const& probes, int rounds)
+{
+	std::size_t hits = 0;
+	for (int r = 0; r < rounds; ++r) {
+		for (std::string const& p : probes) {
+			hits += coll.find(std::string_view(p)) != coll.end();
+		}
+	}
+	return hits;
+}
+
+int main()
+{
+	using CustomerOP = Overloader<CustomerHash, CustomerEq>;
+
+	FlatHashSet<Customer, CustomerHash, CustomerEq> coll1;
+	FlatHashSet<Customer, CustomerOP, CustomerOP> coll2;
+	coll1.insert(Customer("nico"));
+	coll2.emplace("nico");
+	std::cout << coll1.contains(std::string_view("nico")) << ' '
+	          << coll2.contains(Customer("nico")) << '\n';
+
+	// benchmark: 1M customers, lookups with 90% and 10% hits
+	constexpr std::size_t n = 1'000'000;
+	std::vector<std::string> names;
+	for (std::size_t i = 0; i < n; ++i) {
+		names.push_back("customer#" + std::to_string(i));
+	}
+
+	std::unordered_set<Customer, CustomerHash, CustomerEq> stdSet;
+	FlatHashSet<Customer, CustomerHash, CustomerEq> flatSet;
+	for (std::string const& name : names) {
+		stdSet.emplace(name);
+		flatSet.emplace(name);
+	}
+
+	std::mt19937 rnd(42);
+	auto makeProbes = [&](double hitRate) {
+		std::vector<std::string> probes;
+		std::bernoulli_distribution hit(hitRate);
+		for (std::size_t i = 0; i < n; ++i) {
+			std::string const& name = names[rnd() % n];
+			probes.push_back(hit(rnd) ? name : name + "?");
+		}
+		return probes;
+	};
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+	for (double hitRate : {0.9, 0.1}) {
+		std::vector<std::string> probes = makeProbes(hitRate);
+		auto t0 = Clock::now();
+		std::size_t hits1 = lookupAll(stdSet, probes, 3);
+		auto t1 = Clock::now();
+		std::size_t hits2 = lookupAll(flatSet, probes, 3);
+		auto t2 = Clock::now();
+		std::cout << "hit rate " << hitRate << ": "
+		          << "std::unordered_set " << ms(t1 - t0) << " ms, "
+		          << "FlatHashSet " << ms(t2 - t1) << " ms"
+		          << (hits1 == hits2 ? "" : " (DIFFERENT RESULTS)") << '\n';
+	}
+
+	// batch lookups: throughput by the number of keys per find_many() call
+	std::vector<std::string> probes = makeProbes(0.5);
+	std::vector<std::string_view> keys(probes.begin(), probes.end());
+	std::vector<FlatHashSet<Customer, CustomerHash, CustomerEq>::const_iterator> results(n);
+	for (std::size_t batch : {1, 4, 16, 64, 256}) {
+		auto t0 = Clock::now();
+		for (std::size_t i = 0; i < n; i += batch) {
+			std::span<std::string_view const> part(keys.data() + i, std::min(batch, n - i));
+			flatSet.find_many(part, results.begin() + i);
+		}
+		auto t1 = Clock::now();
+		std::size_t hits = 0;
+		for (auto pos : results) {
+			hits += pos != flatSet.end();
+		}
+		std::cout << "batch size " << batch << ": "
+		          << n / ms(t1 - t0) / 1000 << " M lookups/s (" << hits << " hits)\n";
+	}
+}
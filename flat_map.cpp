@@ -0,0 +1,303 @@
+// Flat Sorted Map with Branchless and Eytzinger Search
+
+// errors1.cpp searches a std::map<std::string, double> with std::find_if.
+// std::map is a red-black tree: every element is a separate node, and both a
+// lookup (O(log n) nodes) and a scan (all nodes, in key order, but anywhere in
+// memory) jump from cache miss to cache miss.
+
+// FlatMap<> keeps keys and values in two sorted, contiguous arrays:
+//  - a scan (find_if) walks two arrays sequentially, which the hardware
+//    prefetcher streams at memory bandwidth
+//  - a lookup is a binary search without branches: the comparison only
+//    selects the next position (a conditional move), so there are no
+//    mispredicted branches, just one load per level
+//  - optionally, the keys are also stored in Eytzinger order (the implicit
+//    tree layout of a binary heap, see tree_layouts.cpp): the first levels
+//    of the search share a few cache lines, and the next levels can be
+//    prefetched because their addresses are computed, not loaded
+//    (this costs a second copy of the keys, and it only pays off once the
+//    keys no longer fit into the last-level cache; below that, the plain
+//    branchless search is usually faster)
+//  - the usual way to build it is in bulk: collect the elements unsorted,
+//    then sort once (O(n log n)) instead of n tree insertions
+// Inserting a single element in the middle is O(n) though, so FlatMap<> is
+// meant for maps that are read much more often than they are modified.
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+template<typename K, typename V, typename Compare = std::less<>>
+class FlatMap
+{
+private:
+	std::vector<K> keys;
+	std::vector<V> values;
+	Compare comp;
+
+	// Eytzinger layout (optional): eytzKeys[k] is the key at node k (1-based),
+	// eytzRank[k] its position in keys/values
+	std::vector<K> eytzKeys;
+	std::vector<std::uint32_t> eytzRank;
+
+	template<typename Key>
+	std::size_t lowerBoundSorted(Key const& key) const {
+		K const* base = keys.data();
+		std::size_t n = keys.size();
+		if (n == 0) {
+			return 0;
+		}
+		while (n > 1) {
+			std::size_t half = n / 2;
+			base = comp(base[half], key) ? base + half : base;
+			n -= half;
+		}
+		return static_cast<std::size_t>(base - keys.data()) + comp(*base, key);
+	}
+
+	template<typename Key>
+	std::size_t lowerBoundEytzinger(Key const& key) const {
+		// the descendants of k some levels down share one cache line:
+		// prefetch it while these levels are compared (the address is
+		// computed as an integer, as it may lie past the end of the vector)
+		constexpr std::size_t perLine = sizeof(K) < 64 ? 64 / sizeof(K) : 1;
+		std::size_t n = keys.size();
+		std::size_t k = 1;
+		while (k <= n) {
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(reinterpret_cast<void const*>(
+				reinterpret_cast<std::uintptr_t>(eytzKeys.data()) + perLine * k * sizeof(K)));
+#endif
+			k = 2 * k + comp(eytzKeys[k], key);
+		}
+		// the last left turn is the lower bound (k == 0: all keys are smaller)
+		k >>= std::countr_one(k) + 1;
+		return k == 0 ? n : eytzRank[k];
+	}
+
+	void fillEytzinger(std::size_t& rank, std::size_t k) {
+		if (k <= keys.size()) {
+			fillEytzinger(rank, 2 * k);
+			eytzKeys[k] = keys[rank];
+			eytzRank[k] = static_cast<std::uint32_t>(rank++);
+			fillEytzinger(rank, 2 * k + 1);
+		}
+	}
+
+	template<bool Const>
+	class Iter
+	{
+	private:
+		using Map = std::conditional_t<Const, FlatMap const, FlatMap>;
+		using Value = std::conditional_t<Const, V const, V>;
+		Map* map = nullptr;
+		std::size_t idx = 0;
+		friend class FlatMap;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = std::pair<K, V>;
+		using difference_type = std::ptrdiff_t;
+		// like std::map the element is a pair of key and value, but the pair
+		// is made of references into the two arrays
+		using reference = std::pair<K const&, Value&>;
+		struct pointer {
+			reference ref;
+			reference* operator->() { return &ref; }
+		};
+
+		Iter() = default;
+		Iter(Map* m, std::size_t i) : map(m), idx(i) {}
+		operator Iter<true>() const { return Iter<true>(map, idx); }
+
+		K const& key() const { return map->keys[idx]; }
+		Value& value() const { return map->values[idx]; }
+
+		reference operator*() const { return reference(key(), value()); }
+		pointer operator->() const { return pointer{**this}; }
+		reference operator[](difference_type n) const { return *(*this + n); }
+
+		Iter& operator++() { ++idx; return *this; }
+		Iter operator++(int) { Iter tmp = *this; ++idx; return tmp; }
+		Iter& operator--() { --idx; return *this; }
+		Iter operator--(int) { Iter tmp = *this; --idx; return tmp; }
+		Iter& operator+=(difference_type n) { idx += n; return *this; }
+		Iter& operator-=(difference_type n) { idx -= n; return *this; }
+		friend Iter operator+(Iter it, difference_type n) { return it += n; }
+		friend Iter operator+(difference_type n, Iter it) { return it += n; }
+		friend Iter operator-(Iter it, difference_type n) { return it -= n; }
+		friend difference_type operator-(Iter const& a, Iter const& b) {
+			return static_cast<difference_type>(a.idx) - static_cast<difference_type>(b.idx);
+		}
+		friend bool operator==(Iter const& a, Iter const& b) { return a.idx == b.idx; }
+		friend auto operator<=>(Iter const& a, Iter const& b) { return a.idx <=> b.idx; }
+	};
+
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using iterator = Iter<false>;
+	using const_iterator = Iter<true>;
+
+	FlatMap() = default;
+
+	// bulk build from unsorted (key, value) pairs
+	// as with std::map::insert(), the first of several equal keys wins
+	template<typename InputIt>
+	FlatMap(InputIt first, InputIt last, Compare const& c = Compare()) : comp(c) {
+		std::vector<std::pair<K, V>> elems(first, last);
+		std::stable_sort(elems.begin(), elems.end(), [&](auto const& a, auto const& b) {
+			return comp(a.first, b.first);
+		});
+		keys.reserve(elems.size());
+		values.reserve(elems.size());
+		for (auto& e : elems) {
+			if (keys.empty() || comp(keys.back(), e.first)) {
+				keys.push_back(std::move(e.first));
+				values.push_back(std::move(e.second));
+			}
+		}
+	}
+
+	FlatMap(std::initializer_list<std::pair<K, V>> il, Compare const& c = Compare())
+	 : FlatMap(il.begin(), il.end(), c) {
+	}
+
+	// switch lookups to the Eytzinger layout
+	// (until the next modification of the map)
+	void buildEytzinger() {
+		eytzKeys.assign(keys.size() + 1, K{});
+		eytzRank.assign(keys.size() + 1, 0);
+		std::size_t rank = 0;
+		fillEytzinger(rank, 1);
+	}
+
+	bool usesEytzinger() const {
+		return !eytzRank.empty();
+	}
+
+	std::size_t size() const { return keys.size(); }
+	bool empty() const { return keys.empty(); }
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, keys.size()); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, keys.size()); }
+
+	// the raw arrays, e.g. for scans that only need the keys or only the values
+	std::vector<K> const& keyArray() const { return keys; }
+	std::vector<V> const& valueArray() const { return values; }
+
+	template<typename Key>
+	const_iterator lower_bound(Key const& key) const {
+		return const_iterator(this, usesEytzinger() ? lowerBoundEytzinger(key)
+		                                            : lowerBoundSorted(key));
+	}
+
+	template<typename Key>
+	const_iterator find(Key const& key) const {
+		const_iterator pos = lower_bound(key);
+		return pos != end() && !comp(key, pos.key()) ? pos : end();
+	}
+
+	template<typename Key>
+	iterator find(Key const& key) {
+		const_iterator pos = std::as_const(*this).find(key);
+		return iterator(this, pos.idx);
+	}
+
+	template<typename Key>
+	bool contains(Key const& key) const {
+		return find(key) != end();
+	}
+
+	// O(n): shifts all following elements
+	std::pair<iterator, bool> insert(K key, V value) {
+		std::size_t i = lowerBoundSorted(key);
+		if (i < keys.size() && !comp(key, keys[i])) {
+			return {iterator(this, i), false};
+		}
+		keys.insert(keys.begin() + i, std::move(key));
+		values.insert(values.begin() + i, std::move(value));
+		eytzKeys.clear();
+		eytzRank.clear();
+		return {iterator(this, i), true};
+	}
+
+	V& operator[](K const& key) {
+		return insert(key, V{}).first.value();
+	}
+
+	// predicate scan in key order over the contiguous arrays
+	// pred is called with (key, value) and the first match is returned
+	template<typename Pred>
+	const_iterator find_if(Pred pred) const {
+		for (std::size_t i = 0; i < keys.size(); ++i) {
+			if (pred(keys[i], values[i])) {
+				return const_iterator(this, i);
+			}
+		}
+		return end();
+	}
+};
+
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+int main()
+{
+	FlatMap<std::string, double> coll = {{"pi", 3.14}, {"e", 2.72}, {"", 0}, {"phi", 1.62}};
+
+	// as in errors1.cpp, but the element type of the map is a pair,
+	// so the lambda has to take the pair (or use the member find_if())
+	auto pos = std::find_if(coll.begin(), coll.end(), [](auto const& kv) {
+		return kv.first != "";
+	});
+	std::cout << pos->first << ": " << pos->second << '\n';                       // e: 2.72
+	std::cout << coll.find_if([](std::string const& s, double) { return s != ""; }).key() << '\n';
+	std::cout << coll.find("phi").value() << ' ' << coll.contains("tau") << '\n';  // 1.62 0
+
+	// lookups: std::map vs. FlatMap (sorted and Eytzinger)
+	constexpr std::size_t n = 1'000'000;
+	std::mt19937 rnd(42);
+	std::vector<std::pair<std::uint64_t, double>> elems;
+	for (std::size_t i = 0; i < n; ++i) {
+		elems.emplace_back(rnd(), double(i));
+	}
+	std::map<std::uint64_t, double> treeMap(elems.begin(), elems.end());
+	FlatMap<std::uint64_t, double> flatMap(elems.begin(), elems.end());
+	FlatMap<std::uint64_t, double> eytzMap(elems.begin(), elems.end());
+	eytzMap.buildEytzinger();
+
+	std::vector<std::uint64_t> probes;
+	for (std::size_t i = 0; i < n; ++i) {
+		probes.push_back(i % 2 ? elems[rnd() % n].first : rnd());
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+	auto measure = [&](char const* name, auto const& map) {
+		auto t0 = Clock::now();
+		std::size_t hits = 0;
+		for (std::uint64_t p : probes) {
+			hits += map.find(p) != map.end();
+		}
+		std::cout << name << ms(Clock::now() - t0) << " ms (" << hits << " hits)\n";
+	};
+	measure("std::map:            ", treeMap);
+	measure("FlatMap (sorted):    ", flatMap);
+	measure("FlatMap (Eytzinger): ", eytzMap);
+}
@@ -13,29 +13,152 @@ struct DoIsPrime<p,2> {
 // primary template
 // start recursion with divisor from p / 2
 template<unsigned p>
-struct IsPrime {
+struct RecursiveIsPrime {
 	static constexpr bool value = DoIsPrime<p, p/2>::value;
 };
 
 // to avoid endless recursion with template instantiation
 template<>
-struct IsPrime<0> { static constexpr bool value = false; };
+struct RecursiveIsPrime<0> { static constexpr bool value = false; };
 
 template<>
-struct IsPrime<1> { static constexpr bool value = false; };
+struct RecursiveIsPrime<1> { static constexpr bool value = false; };
 
 template<>
-struct IsPrime<2> { static constexpr bool value = true; };
+struct RecursiveIsPrime<2> { static constexpr bool value = true; };
 
 template<>
-struct IsPrime<3> { static constexpr bool value = true; };
+struct RecursiveIsPrime<3> { static constexpr bool value = true; };
 
 
-// IsPrime<9>;:value
+// RecursiveIsPrime<9>;:value
 
 // expands to DoIsPrime<9, 4>::value
 // expands to 9%4 != 0 && DoIsPrime<9,3>::value
 // expands to 9%4 != 0 && 9%3 != 0 && DoIsPrime<9,2>::value
 // expands to 9%4 != 0 && 9%3 != 0 && 9%2 != 0  
 
-// 9%3 != 0 (false), 
\ No newline at end of file
+// 9%3 != 0 (false), 
+
+
+// Every step of the recursion is a new template instantiation, so checking p
+// instantiates p/2 class templates: slow to compile, and for p in the
+// thousands it runs into the instantiation depth limit of the compiler.
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// Since C++14, the same can be computed by an ordinary constexpr function:
+//  - a loop instead of recursive instantiations
+//  - a divisor larger than sqrt(p) has a partner smaller than sqrt(p),
+//    so the loop stops at sqrt(p)
+//  - after 2 and 3, only divisors of the form 6k - 1 and 6k + 1 are left
+// That is O(sqrt(p)) steps instead of O(p) templates.
+constexpr bool isPrime(unsigned p)
+{
+	if (p < 4) {
+		return p > 1;
+	}
+	if (p % 2 == 0 || p % 3 == 0) {
+		return false;
+	}
+	for (unsigned d = 5; d <= p / d; d += 6) {     // d * d <= p without overflow
+		if (p % d == 0 || p % (d + 2) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// the same result as RecursiveIsPrime<p>::value, for any p
+static_assert(isPrime(9) == RecursiveIsPrime<9>::value && isPrime(3) == RecursiveIsPrime<3>::value);
+
+// IsPrime<p>::value stays the interface, but is computed by isPrime():
+// no recursion, so no special cases for 0 to 3 and no depth limit
+template<unsigned p>
+struct IsPrime {
+	static constexpr bool value = isPrime(p);
+};
+
+
+// For many queries up to a known bound N, a sieve of Eratosthenes computed
+// at compile time answers each query with one bit test, O(1) at runtime.
+// The bitmap is a constexpr object: it lives in read-only memory and
+// costs nothing at program start.
+// Only odd numbers get a bit (bit i stands for 2i + 1), which halves both
+// the table and the work of the compiler: constant evaluation is slow, and
+// for large N the limits of the compiler (-fconstexpr-ops-limit,
+// -fconstexpr-loop-limit, -fconstexpr-steps) may have to be raised.
+template<std::size_t N>
+struct PrimeSieve {
+	std::array<std::uint64_t, N / 128 + 1> bits{};
+
+	constexpr bool contains(std::size_t n) const {
+		if (n % 2 == 0) {
+			return n == 2 && N >= 2;
+		}
+		return n <= N && (bits[n / 128] >> (n / 2 % 64) & 1);
+	}
+
+	constexpr std::size_t count() const {
+		std::size_t c = N >= 2;
+		for (std::uint64_t w : bits) {
+			c += std::popcount(w);
+		}
+		return c;
+	}
+};
+
+template<std::size_t N>
+constexpr PrimeSieve<N> makePrimeSieve()
+{
+	PrimeSieve<N> sieve;
+	constexpr std::size_t numOdd = (N + 1) / 2;        // 1, 3, 5, ..., up to N
+	for (std::size_t w = 0; w < sieve.bits.size(); ++w) {
+		std::size_t first = w * 64;
+		sieve.bits[w] = first >= numOdd ? 0
+		              : numOdd - first >= 64 ? ~std::uint64_t(0)
+		              : (std::uint64_t(1) << (numOdd - first)) - 1;
+	}
+	sieve.bits[0] &= ~std::uint64_t(1);                // 1 is not prime
+	for (std::size_t p = 3; p * p <= N; p += 2) {
+		if (sieve.contains(p)) {
+			// odd multiples only: p*p, p*p + 2p, ...
+			for (std::size_t i = p * p / 2; i < numOdd; i += p) {
+				sieve.bits[i / 64] &= ~(std::uint64_t(1) << (i % 64));
+			}
+		}
+	}
+	return sieve;
+}
+
+template<std::size_t N>
+constexpr PrimeSieve<N> primeSieve = makePrimeSieve<N>();
+
+// all primes up to N as a sorted array (its size is computed by the sieve)
+template<std::size_t N>
+constexpr auto makePrimeArray()
+{
+	constexpr auto const& sieve = primeSieve<N>;
+	std::array<unsigned, sieve.count()> primes{};
+	std::size_t i = 0;
+	if constexpr (N >= 2) {
+		primes[i++] = 2;
+	}
+	for (std::size_t w = 0; w < sieve.bits.size(); ++w) {
+		for (std::uint64_t bits = sieve.bits[w]; bits != 0; bits &= bits - 1) {
+			primes[i++] = static_cast<unsigned>(2 * (w * 64 + std::countr_zero(bits)) + 1);
+		}
+	}
+	return primes;
+}
+
+template<std::size_t N>
+constexpr auto primesUpTo = makePrimeArray<N>();
+
+
+static_assert(IsPrime<65521>::value);                   // RecursiveIsPrime<65521> would not compile
+static_assert(primeSieve<100000>.contains(99991));
+static_assert(primesUpTo<100>.size() == 25 && primesUpTo<100>.back() == 97);
@@ -0,0 +1,205 @@
+// Interning Customer Names
+
+// Every Customer (see variadic_base_classes.cpp and errors2.cpp) owns its
+// own std::string name. If the same names show up in many customers (or
+// in several sets), the same characters are stored again and again, and
+// comparing two customers means comparing two strings.
+
+// Interning stores each distinct name exactly once in a pool and hands out a
+// small handle instead:
+//  - a handle is a 32-bit index (std::string is 32 bytes in libstdc++,
+//    plus a heap allocation for names longer than 15 characters)
+//  - handle to name is an array access: O(1)
+//  - two handles of the same pool are equal if and only if the names are equal,
+//    so equality is an integer comparison and the hash can be computed
+//    from the handle without looking at the characters at all
+
+// The characters live in large blocks (an arena) that are never moved or freed
+// while the pool exists, so the std::string_views handed out stay valid.
+// NOTE: NamePool is not thread-safe; concurrent intern() calls need a lock.
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+class NameHandle
+{
+private:
+	std::uint32_t id;
+public:
+	explicit constexpr NameHandle(std::uint32_t i) : id(i) {}
+	constexpr std::uint32_t index() const noexcept { return id; }
+	friend constexpr bool operator== (NameHandle a, NameHandle b) noexcept {
+		return a.id == b.id;
+	}
+	friend constexpr bool operator!= (NameHandle a, NameHandle b) noexcept {
+		return a.id != b.id;
+	}
+};
+
+// the ids are consecutive, so multiply to spread them over all bits
+namespace std {
+template<>
+struct hash<NameHandle>
+{
+	std::size_t operator() (NameHandle h) const noexcept {
+		return static_cast<std::size_t>(h.index() * 0x9E3779B97F4A7C15ull);
+	}
+};
+}
+
+
+class NamePool
+{
+private:
+	static constexpr std::size_t blockSize = 64 * 1024;
+
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::vector<std::unique_ptr<char[]>> largeBlocks;
+	std::size_t blockUsed = blockSize;                    // no block yet
+	std::vector<std::string_view> names;                   // handle -> name
+	std::unordered_map<std::string_view, std::uint32_t> index;   // name -> handle
+
+	// copy the characters into the arena
+	std::string_view store(std::string_view s) {
+		if (s.empty()) {
+			// no characters to copy (and possibly no block yet)
+			return std::string_view();
+		}
+		if (s.size() > blockSize / 4) {
+			// large names get a block of their own, so that they don't waste
+			// the rest of the current block
+			largeBlocks.push_back(std::make_unique<char[]>(s.size()));
+			std::memcpy(largeBlocks.back().get(), s.data(), s.size());
+			return std::string_view(largeBlocks.back().get(), s.size());
+		}
+		if (blockUsed + s.size() > blockSize) {
+			blocks.push_back(std::make_unique<char[]>(blockSize));
+			blockUsed = 0;
+		}
+		char* p = blocks.back().get() + blockUsed;
+		std::memcpy(p, s.data(), s.size());
+		blockUsed += s.size();
+		return std::string_view(p, s.size());
+	}
+
+public:
+	NamePool() = default;
+	NamePool(NamePool const&) = delete;
+	NamePool& operator= (NamePool const&) = delete;
+
+	// returns the handle of the name, storing the name if it is new
+	NameHandle intern(std::string_view s) {
+		if (auto pos = index.find(s); pos != index.end()) {
+			return NameHandle(pos->second);
+		}
+		assert(names.size() < std::numeric_limits<std::uint32_t>::max());
+		std::string_view stored = store(s);
+		auto id = static_cast<std::uint32_t>(names.size());
+		names.push_back(stored);
+		index.emplace(stored, id);
+		return NameHandle(id);
+	}
+
+	// returns the handle if the name is already interned
+	// (lookups by name that must not grow the pool)
+	std::optional<NameHandle> find(std::string_view s) const {
+		auto pos = index.find(s);
+		if (pos == index.end()) {
+			return std::nullopt;
+		}
+		return NameHandle(pos->second);
+	}
+
+	std::string_view view(NameHandle h) const {
+		assert(h.index() < names.size());
+		return names[h.index()];
+	}
+
+	std::size_t size() const {
+		return names.size();
+	}
+};
+
+
+// Customer with an interned name
+// All customers share one pool, so their handles can be compared
+inline NamePool& customerNames()
+{
+	static NamePool pool;
+	return pool;
+}
+
+struct Customer
+{
+private:
+	NameHandle name;
+public:
+	Customer(std::string_view n) : name(customerNames().intern(n)) {}
+	std::string getName() const { return std::string(getNameView()); }
+	std::string_view getNameView() const noexcept { return customerNames().view(name); }
+	NameHandle getNameHandle() const noexcept { return name; }
+};
+
+// neither functor looks at the characters
+struct CustomerEq
+{
+	bool operator() (Customer const& c1, Customer const& c2) const noexcept
+	{
+		return c1.getNameHandle() == c2.getNameHandle();
+	}
+};
+
+struct CustomerHash
+{
+	std::size_t operator() (Customer const& c) const noexcept {
+		return std::hash<NameHandle>()(c.getNameHandle());
+	}
+};
+
+template<typename... Bases>
+struct Overloader : Bases...
+{
+	using Bases::operator()...;
+};
+
+
+#include <iostream>
+#include <unordered_set>
+
+int main()
+{
+	using CustomerOP = Overloader<CustomerHash, CustomerEq>;
+
+	std::unordered_set<Customer, CustomerHash, CustomerEq> coll1;
+	std::unordered_set<Customer, CustomerOP, CustomerOP> coll2;
+
+	for (int i = 0; i < 1000; ++i) {
+		std::string name = "customer#" + std::to_string(i % 100);
+		coll1.emplace(name);
+		coll2.emplace(name);
+	}
+
+	std::cout << sizeof(Customer) << " bytes per customer\n";
+	std::cout << customerNames().size() << " distinct names\n";       // 100
+	std::cout << coll1.size() << ' ' << coll2.size() << '\n';           // 100 100
+	std::cout << coll1.count(Customer("customer#42")) << '\n';        // 1
+
+	// probing by name without interning it
+	std::cout << customerNames().find("nobody").has_value() << '\n';   // 0
+
+	// an empty name as the very first name of a pool
+	NamePool pool;
+	NameHandle empty = pool.intern("");
+	std::cout << (pool.intern("") == empty) << ' ' << pool.view(empty).size() << ' '
+	          << (pool.intern("x") != empty) << '\n';                    // 1 0 1
+}
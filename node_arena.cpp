@@ -0,0 +1,139 @@
+// Index-based Arena for Node Trees
+
+// The Node tree from fold_expressions.cpp allocates every node with new and
+// links the nodes with 64-bit pointers:
+//      sizeof(Node) == 24 on a typical 64-bit platform (int + padding + 2 pointers)
+// Building a tree costs one allocation per node, and nodes that are allocated
+// at different times end up anywhere in the heap.
+
+// Instead, all nodes can live in one contiguous std::vector and refer to each
+// other by their position in that vector:
+//  - building a tree is a push_back (amortized, no allocation per node)
+//  - a 32-bit index is half the size of a pointer, so sizeof(ArenaNode) == 12
+//    and more than five nodes fit into one cache line
+//  - indices stay valid if the vector reallocates, pointers wouldn't
+//  - freeing the whole tree is a single clear() (or the destructor)
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+struct ArenaNode {
+    using index_type = std::uint32_t;
+    static constexpr index_type null = std::numeric_limits<index_type>::max();
+
+    int value;
+    index_type left;
+    index_type right;
+};
+
+static_assert(sizeof(ArenaNode) == 12);
+
+
+class NodeArena;
+
+// NodeRef is to an index what Node* is to an address:
+// it knows where to look the index up, so that operator->* can follow
+// a member index just like the built-in operator follows a member pointer
+class NodeRef {
+private:
+    NodeArena* arena;
+    ArenaNode::index_type idx;
+public:
+    NodeRef(NodeArena& a, ArenaNode::index_type i) : arena(&a), idx(i) {}
+
+    ArenaNode::index_type index() const { return idx; }
+    explicit operator bool() const { return idx != ArenaNode::null; }
+
+    ArenaNode* operator->() const;
+    NodeRef operator->* (ArenaNode::index_type ArenaNode::* path) const;
+};
+
+class NodeArena {
+private:
+    std::vector<ArenaNode> nodes;
+public:
+    using index_type = ArenaNode::index_type;
+
+    void reserve(std::size_t n) {
+        nodes.reserve(n);
+    }
+
+    index_type create(int value = 0) {
+        assert(nodes.size() < ArenaNode::null);
+        nodes.push_back(ArenaNode{value, ArenaNode::null, ArenaNode::null});
+        return static_cast<index_type>(nodes.size() - 1);
+    }
+
+    NodeRef ref(index_type i) {
+        return NodeRef(*this, i);
+    }
+
+    ArenaNode& operator[] (index_type i) {
+        assert(i < nodes.size());
+        return nodes[i];
+    }
+    ArenaNode const& operator[] (index_type i) const {
+        assert(i < nodes.size());
+        return nodes[i];
+    }
+
+    std::size_t size() const {
+        return nodes.size();
+    }
+
+    // frees all nodes of all trees in the arena at once
+    // (all indices handed out so far become invalid)
+    void clear() {
+        nodes.clear();
+    }
+};
+
+inline ArenaNode* NodeRef::operator->() const
+{
+    return &(*arena)[idx];
+}
+
+inline NodeRef NodeRef::operator->* (ArenaNode::index_type ArenaNode::* path) const
+{
+    return NodeRef(*arena, (*arena)[idx].*path);
+}
+
+
+// the member "pointers" now select an index instead of a pointer
+auto left = &ArenaNode::left;
+auto right = &ArenaNode::right;
+
+// same fold expression as for Node*:
+// (np ->* ... ->* paths) expands to ((np ->* path1) ->* path2) ->* ...
+template<typename... TP>
+NodeRef traverse(NodeRef np, TP... paths) {
+    return (np ->* ... ->* paths);
+}
+
+// and a version for code that only deals with indices
+template<typename... TP>
+ArenaNode::index_type traverse(NodeArena const& arena, ArenaNode::index_type i, TP... paths) {
+    ((i = arena[i].*paths), ...);
+    return i;
+}
+
+
+#include <iostream>
+
+int main()
+{
+    NodeArena arena;
+    auto root = arena.create(0);
+    arena[root].left = arena.create(1);
+    arena[arena[root].left].right = arena.create(2);
+
+    NodeRef node = traverse(arena.ref(root), left, right);
+    std::cout << node->value << '\n';
+
+    std::cout << arena[traverse(arena, root, left, right)].value << '\n';
+
+    arena.clear();      // instead of deleting node by node
+}
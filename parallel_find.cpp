@@ -0,0 +1,284 @@
+// Parallel find_if with Early Termination
+
+// std::find_if (as in errors1.cpp) scans a range on one core. For millions of
+// elements the range can be split into chunks that are scanned by several
+// threads at once. Two things make find_if different from, say, a parallel sum:
+//  - the result has to be the FIRST match in order, not just any match
+//  - once a match is found, chunks behind it don't have to be scanned at all
+
+// The chunks are handed out in ascending order from a shared counter, and the
+// lowest match found so far is kept in an atomic index:
+//  - a thread that finds a match at i lowers the index to i (if it is lower)
+//  - before each block of a chunk, a thread checks whether the block still
+//    starts before the best match; if not, nothing it could find would win,
+//    and since all chunks it would get next are even further behind, it stops
+// So a match in the first chunk cancels the scan of everything else after at
+// most one block per thread.
+
+// The range needs random-access iterators, so that chunks can be cut without
+// walking the range (vectors, arrays, deques, FlatMap of flat_map.cpp, ...).
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// a fixed set of worker threads that run one job at a time (fork-join)
+class ThreadPool
+{
+private:
+	std::vector<std::thread> threads;
+	std::mutex jobMutex;                 // one runOnAll() at a time
+	std::mutex mtx;
+	std::condition_variable startCv;
+	std::condition_variable doneCv;
+	std::function<void()> const* job = nullptr;
+	std::size_t generation = 0;
+	std::size_t running = 0;
+	bool stop = false;
+
+	// the pool whose job the current thread runs (if any)
+	static inline thread_local ThreadPool const* current = nullptr;
+
+	struct JobScope {
+		ThreadPool const* outer;
+		explicit JobScope(ThreadPool const* pool) : outer(std::exchange(current, pool)) {}
+		~JobScope() { current = outer; }
+	};
+
+	void work() {
+		std::size_t seen = 0;
+		for (;;) {
+			std::function<void()> const* j;
+			{
+				std::unique_lock<std::mutex> lk(mtx);
+				startCv.wait(lk, [&] { return stop || generation != seen; });
+				if (stop) {
+					return;
+				}
+				seen = generation;
+				j = job;
+			}
+			{
+				JobScope scope(this);
+				(*j)();
+			}
+			std::lock_guard<std::mutex> lg(mtx);
+			if (--running == 0) {
+				doneCv.notify_one();
+			}
+		}
+	}
+
+public:
+	// numThreads workers in addition to the thread calling runOnAll()
+	explicit ThreadPool(unsigned numThreads = std::max(1u, std::thread::hardware_concurrency()) - 1) {
+		for (unsigned i = 0; i < numThreads; ++i) {
+			threads.emplace_back([this] { work(); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lg(mtx);
+			stop = true;
+		}
+		startCv.notify_all();
+		for (auto& t : threads) {
+			t.join();
+		}
+	}
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator= (ThreadPool const&) = delete;
+
+	static ThreadPool& instance() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	// the number of threads that run a job (the workers and the caller)
+	std::size_t concurrency() const {
+		return threads.size() + 1;
+	}
+
+	// true while the calling thread runs a job of this pool
+	bool insideJob() const {
+		return current == this;
+	}
+
+	// runs f on every worker and on the calling thread
+	// and returns when all of them are done (f must not throw)
+	// Calling it from a job of the same pool would wait for the workers
+	// (and jobMutex) that are busy with that very job, a deadlock, so that
+	// throws std::logic_error instead.
+	void runOnAll(std::function<void()> const& f) {
+		if (insideJob()) {
+			throw std::logic_error("ThreadPool::runOnAll() called from a job of the same pool");
+		}
+		std::lock_guard<std::mutex> jobLock(jobMutex);
+		{
+			std::lock_guard<std::mutex> lg(mtx);
+			job = &f;
+			running = threads.size();
+			++generation;
+		}
+		startCv.notify_all();
+		{
+			JobScope scope(this);
+			f();
+		}
+		std::unique_lock<std::mutex> lk(mtx);
+		doneCv.wait(lk, [&] { return running == 0; });
+	}
+};
+
+
+template<typename RandomIt, typename Pred>
+RandomIt parallelFindIf(RandomIt first, RandomIt last, Pred pred,
+                        ThreadPool& pool = ThreadPool::instance(),
+                        std::size_t grain = 16 * 1024)
+{
+	static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+	                                typename std::iterator_traits<RandomIt>::iterator_category>,
+	              "parallelFindIf() requires random-access iterators");
+	auto n = static_cast<std::size_t>(last - first);
+	// called from a predicate that already runs on this pool (a nested
+	// search): the other threads are busy, so this thread searches alone
+	if (pool.concurrency() == 1 || n < 2 * grain || pool.insideJob()) {
+		return std::find_if(first, last, pred);
+	}
+
+	// several chunks per thread, so that threads that skip or finish
+	// early get more work; blocks are the unit of cancellation
+	std::size_t chunk = std::max(grain, n / (8 * pool.concurrency()));
+	std::size_t numChunks = (n + chunk - 1) / chunk;
+	constexpr std::size_t block = 1024;
+
+	std::atomic<std::size_t> nextChunk{0};
+	std::atomic<std::size_t> best{n};
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	auto lowerBest = [&](std::size_t i) {
+		std::size_t cur = best.load(std::memory_order_relaxed);
+		while (i < cur && !best.compare_exchange_weak(cur, i, std::memory_order_relaxed)) {
+		}
+	};
+
+	pool.runOnAll([&] {
+		try {
+			for (;;) {
+				std::size_t c = nextChunk.fetch_add(1, std::memory_order_relaxed);
+				if (c >= numChunks) {
+					return;
+				}
+				std::size_t end = std::min(n, (c + 1) * chunk);
+				for (std::size_t b = c * chunk; b < end; b += block) {
+					if (b >= best.load(std::memory_order_relaxed)) {
+						return;         // this and all later chunks are behind a match
+					}
+					std::size_t blockEnd = std::min(end, b + block);
+					for (std::size_t i = b; i < blockEnd; ++i) {
+						if (pred(first[i])) {
+							lowerBest(i);
+							return;
+						}
+					}
+				}
+			}
+		}
+		catch (...) {
+			// the exception of a predicate is rethrown in the caller
+			std::lock_guard<std::mutex> lg(errorMutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+			lowerBest(0);           // cancels all other threads
+		}
+	});
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return first + best.load();
+}
+
+template<typename RandomIt, typename T>
+RandomIt parallelFind(RandomIt first, RandomIt last, T const& value,
+                      ThreadPool& pool = ThreadPool::instance())
+{
+	return parallelFindIf(first, last, [&](auto const& elem) { return elem == value; }, pool);
+}
+
+// any match will do, but as the search for the first match is cancelled by
+// any match in front of it, there is nothing to gain from a separate algorithm
+template<typename RandomIt, typename Pred>
+bool parallelAnyOf(RandomIt first, RandomIt last, Pred pred,
+                   ThreadPool& pool = ThreadPool::instance())
+{
+	return parallelFindIf(first, last, pred, pool) != last;
+}
+
+
+#include <chrono>
+#include <iostream>
+
+int main()
+{
+	// a flat "config": 20M (key, value) entries, with the only invalid
+	// entries somewhere in the second half
+	constexpr std::size_t n = 20'000'000;
+	std::vector<std::pair<std::uint32_t, double>> coll(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		coll[i] = {static_cast<std::uint32_t>(i), 1.0};
+	}
+	coll[n / 2 + 12345].second = -1.0;
+	coll[n - 7].second = -2.0;
+
+	auto invalid = [](auto const& kv) {
+		return kv.second < 0;
+	};
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	auto t0 = Clock::now();
+	auto pos1 = std::find_if(coll.begin(), coll.end(), invalid);
+	auto t1 = Clock::now();
+	auto pos2 = parallelFindIf(coll.begin(), coll.end(), invalid);
+	auto t2 = Clock::now();
+
+	std::cout << "std::find_if:   " << pos1 - coll.begin() << " in " << ms(t1 - t0) << " ms\n";
+	std::cout << "parallelFindIf: " << pos2 - coll.begin() << " in " << ms(t2 - t1) << " ms ("
+	          << ThreadPool::instance().concurrency() << " threads)\n";
+	std::cout << parallelAnyOf(coll.begin(), coll.end(), [](auto const& kv) {
+		return kv.first == 42;
+	}) << '\n';
+
+	// a search inside the predicate of a search on the same pool runs on
+	// the calling thread instead of waiting for the busy pool
+	std::vector<std::uint32_t> wanted(40'000);
+	for (std::size_t i = 0; i < wanted.size(); ++i) {
+		wanted[i] = static_cast<std::uint32_t>(i * 3);
+	}
+	auto nested = parallelFindIf(coll.begin(), coll.begin() + 100'000, [&](auto const& kv) {
+		return kv.first > 50'000 && !parallelAnyOf(wanted.begin(), wanted.end(), [&](std::uint32_t w) {
+			return w == kv.first;
+		});
+	});
+	std::cout << "nested: " << nested - coll.begin() << '\n';                 // 50002
+}
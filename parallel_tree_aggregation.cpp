@@ -0,0 +1,418 @@
+// Parallel Aggregation over Node Trees
+
+// Aggregating Node::value over a tree (sum, max, ...) with a recursive walk
+// uses a single core. The two subtrees of a node are independent, though,
+// so they can be aggregated in parallel and combined afterwards.
+
+// Requirements for the operator op:
+//  - it has to be associative: op(op(a, b), c) == op(a, op(b, c))
+//  - identity has to be its neutral element: op(identity, x) == x
+// Then the result doesn't depend on how the tree is split.
+
+// Forking for every node would cost far more than the work per node, so we
+// only fork for the top levels of the tree (the grain-size cutoff) and walk
+// the subtrees below that serially.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct Node {
+    int value;
+    Node* left;
+    Node* right;
+    Node(int i = 0) : value(i), left(nullptr), right(nullptr) {}
+};
+
+
+// serial walk
+// iterative in-order traversal: the values are combined from left to right,
+// and degenerated (list-like) trees with millions of levels don't overflow
+// the call stack
+template<typename T, typename Op>
+T aggregate(Node const* np, T identity, Op op)
+{
+    T result = identity;
+    std::vector<Node const*> stack;
+    while (np != nullptr || !stack.empty()) {
+        while (np != nullptr) {
+            stack.push_back(np);
+            np = np->left;
+        }
+        np = stack.back();
+        stack.pop_back();
+        result = op(result, T(np->value));
+        np = np->right;
+    }
+    return result;
+}
+
+// default cutoff: enough forks for about 4 tasks per hardware thread,
+// so that unbalanced subtrees even out
+inline unsigned defaultForkDepth()
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned depth = 2;
+    while ((1u << depth) < 4 * threads) {
+        ++depth;
+    }
+    return depth;
+}
+
+
+// a fixed set of worker threads that run one job at a time (fork-join),
+// as in parallel_find.cpp: the threads are started once, not per call
+class ThreadPool
+{
+private:
+    std::vector<std::thread> threads;
+    std::mutex jobMutex;                 // one runOnAll() at a time
+    std::mutex mtx;
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    std::function<void()> const* job = nullptr;
+    std::size_t generation = 0;
+    std::size_t running = 0;
+    bool stop = false;
+
+    // the pool whose job the current thread runs (if any)
+    static inline thread_local ThreadPool const* current = nullptr;
+
+    struct JobScope {
+        ThreadPool const* outer;
+        explicit JobScope(ThreadPool const* pool) : outer(std::exchange(current, pool)) {}
+        ~JobScope() { current = outer; }
+    };
+
+    void work() {
+        std::size_t seen = 0;
+        for (;;) {
+            std::function<void()> const* j;
+            {
+                std::unique_lock<std::mutex> lk(mtx);
+                startCv.wait(lk, [&] { return stop || generation != seen; });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+                j = job;
+            }
+            {
+                JobScope scope(this);
+                (*j)();
+            }
+            std::lock_guard<std::mutex> lg(mtx);
+            if (--running == 0) {
+                doneCv.notify_one();
+            }
+        }
+    }
+
+public:
+    // numThreads workers in addition to the thread calling runOnAll()
+    explicit ThreadPool(unsigned numThreads = std::max(1u, std::thread::hardware_concurrency()) - 1) {
+        for (unsigned i = 0; i < numThreads; ++i) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            stop = true;
+        }
+        startCv.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator= (ThreadPool const&) = delete;
+
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // the number of threads that run a job (the workers and the caller)
+    std::size_t concurrency() const {
+        return threads.size() + 1;
+    }
+
+    // true while the calling thread runs a job of this pool
+    bool insideJob() const {
+        return current == this;
+    }
+
+    // runs f on every worker and on the calling thread
+    // and returns when all of them are done (f must not throw)
+    // Calling it from a job of the same pool would wait for the workers
+    // (and jobMutex) that are busy with that very job, a deadlock, so that
+    // throws std::logic_error instead.
+    void runOnAll(std::function<void()> const& f) {
+        if (insideJob()) {
+            throw std::logic_error("ThreadPool::runOnAll() called from a job of the same pool");
+        }
+        std::lock_guard<std::mutex> jobLock(jobMutex);
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            job = &f;
+            running = threads.size();
+            ++generation;
+        }
+        startCv.notify_all();
+        {
+            JobScope scope(this);
+            f();
+        }
+        std::unique_lock<std::mutex> lk(mtx);
+        doneCv.wait(lk, [&] { return running == 0; });
+    }
+};
+
+// a result per task or thread, on a cache line of its own: neighboring
+// slots written by different threads would otherwise share a line, and
+// every write would invalidate it in the caches of the other threads
+// (false sharing)
+template<typename T>
+struct alignas(64) Slot {
+    T value;
+};
+
+
+// 1. Fork-join: the top forkDepth levels of the tree are split into tasks
+//    in in-order: the subtrees below the cutoff and the single nodes above
+//    it. The threads of the pool take the tasks from a shared counter, and
+//    the results are combined from left to right afterwards.
+//    The order of the combination is kept, so op only has to be associative
+template<typename T, typename Op>
+T parallelAggregate(Node const* np, T identity, Op op, unsigned forkDepth = defaultForkDepth(),
+                    ThreadPool& pool = ThreadPool::instance())
+{
+    if (np == nullptr) {
+        return identity;
+    }
+    if (forkDepth == 0 || pool.concurrency() == 1 || pool.insideJob()) {
+        return aggregate(np, identity, op);          // (nested: the pool is busy)
+    }
+
+    struct Task {
+        Node const* node;
+        bool whole;                        // the subtree, or only node->value
+    };
+    std::vector<Task> tasks;
+    auto split = [&](auto& self, Node const* n, unsigned depth) -> void {
+        if (n == nullptr) {
+            return;
+        }
+        if (depth == forkDepth) {
+            tasks.push_back(Task{n, true});
+            return;
+        }
+        self(self, n->left, depth + 1);
+        tasks.push_back(Task{n, false});
+        self(self, n->right, depth + 1);
+    };
+    split(split, np, 0);
+
+    std::vector<Slot<T>> results(tasks.size(), Slot<T>{identity});
+    std::atomic<std::size_t> next{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    pool.runOnAll([&] {
+        for (;;) {
+            std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= tasks.size()) {
+                return;
+            }
+            try {
+                results[i].value = tasks[i].whole ? aggregate(tasks[i].node, identity, op)
+                                                  : T(tasks[i].node->value);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lg(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    T result = identity;
+    for (Slot<T> const& r : results) {
+        result = op(result, r.value);
+    }
+    return result;
+}
+
+
+// 2. Work stealing: fork-join splits the tree statically. If the subtrees
+//    below the cutoff have very different sizes (shallow, bushy trees with
+//    a few huge branches), some threads run out of work early.
+//    Here every thread owns a deque of subtrees:
+//    - it takes work from the back of its own deque (the smallest, most
+//      recently split subtrees, still in its cache)
+//    - if it is empty, it steals from the front of another deque (the oldest,
+//      largest subtrees, so one steal buys a lot of work)
+//    Every thread accumulates its own partial result in a local variable and
+//    stores it once at the end, and the partial results are combined in an
+//    arbitrary order, so here op also has to be commutative
+//    (true for sum, max, min, ...).
+template<typename T, typename Op>
+T workStealingAggregate(Node const* root, T identity, Op op,
+                        unsigned splitDepth = defaultForkDepth() + 4,
+                        ThreadPool& pool = ThreadPool::instance())
+{
+    if (root == nullptr) {
+        return identity;
+    }
+    if (pool.insideJob()) {
+        return aggregate(root, identity, op);        // nested: the pool is busy
+    }
+
+    struct Task {
+        Node const* node;
+        unsigned depth;
+    };
+    struct alignas(64) Worker {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    auto numThreads = static_cast<unsigned>(pool.concurrency());
+    std::vector<Worker> workers(numThreads);
+    std::vector<Slot<T>> partial(numThreads, Slot<T>{identity});
+    std::atomic<unsigned> nextId{0};
+    std::atomic<std::size_t> pending{1};      // tasks pushed but not finished yet
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    workers[0].tasks.push_back(Task{root, 0});
+
+    auto push = [&](Worker& w, Task t) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lg(w.mtx);
+        w.tasks.push_back(t);
+    };
+    auto popOwn = [](Worker& w, Task& t) {
+        std::lock_guard<std::mutex> lg(w.mtx);
+        if (w.tasks.empty()) {
+            return false;
+        }
+        t = w.tasks.back();
+        w.tasks.pop_back();
+        return true;
+    };
+    auto steal = [](Worker& w, Task& t) {
+        std::lock_guard<std::mutex> lg(w.mtx);
+        if (w.tasks.empty()) {
+            return false;
+        }
+        t = w.tasks.front();
+        w.tasks.pop_front();
+        return true;
+    };
+
+    pool.runOnAll([&] {
+        unsigned self = nextId.fetch_add(1, std::memory_order_relaxed);
+        T result = identity;
+        Task t;
+        while (pending.load(std::memory_order_acquire) != 0) {
+            bool found = popOwn(workers[self], t);
+            for (unsigned i = 1; !found && i < numThreads; ++i) {
+                found = steal(workers[(self + i) % numThreads], t);
+            }
+            if (!found) {
+                std::this_thread::yield();
+                continue;
+            }
+            try {
+                if (t.depth < splitDepth) {
+                    // split: the children become tasks others can steal
+                    if (t.node->left) {
+                        push(workers[self], Task{t.node->left, t.depth + 1});
+                    }
+                    if (t.node->right) {
+                        push(workers[self], Task{t.node->right, t.depth + 1});
+                    }
+                    result = op(result, T(t.node->value));
+                }
+                else {
+                    result = op(result, aggregate(t.node, identity, op));
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lg(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        }
+        partial[self].value = result;
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    T result = identity;
+    for (Slot<T> const& p : partial) {
+        result = op(result, p.value);
+    }
+    return result;
+}
+
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+int main()
+{
+    // complete tree with 2^22 - 1 nodes
+    std::vector<std::unique_ptr<Node>> nodes;
+    constexpr std::size_t n = (1 << 22) - 1;
+    for (std::size_t i = 0; i < n; ++i) {
+        nodes.push_back(std::make_unique<Node>(static_cast<int>(i % 1000)));
+    }
+    for (std::size_t i = 0; 2 * i + 2 < n; ++i) {
+        nodes[i]->left = nodes[2 * i + 1].get();
+        nodes[i]->right = nodes[2 * i + 2].get();
+    }
+    Node const* root = nodes[0].get();
+
+    auto maxOp = [](int a, int b) { return std::max(a, b); };
+
+    std::cout << aggregate(root, 0L, std::plus<>{}) << '\n';
+    std::cout << parallelAggregate(root, 0L, std::plus<>{}) << '\n';
+    std::cout << workStealingAggregate(root, 0L, std::plus<>{}) << '\n';
+    std::cout << parallelAggregate(root, 0, maxOp) << ' '
+              << workStealingAggregate(root, 0, maxOp) << '\n';
+
+    // many small aggregations: the threads of the pool are started once,
+    // not for every call
+    using Clock = std::chrono::steady_clock;
+    ThreadPool pool(3);
+    Node const* small = nodes[1023].get();     // a subtree with 2^12 - 1 nodes
+    long sum = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        sum += parallelAggregate(small, 0L, std::plus<>{}, 4, pool);
+        sum += workStealingAggregate(small, 0L, std::plus<>{}, 6, pool);
+    }
+    auto t1 = Clock::now();
+    std::cout << "2000 calls on 4 threads: "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms (" << sum << ")\n";
+}
@@ -0,0 +1,249 @@
+// Compile-time Perfect Hashing
+
+// If all keys of a set are known at compile time (allow-lists, routing tables),
+// the compiler can search for a hash function that maps them to different slots:
+// a perfect hash. Then a lookup is:
+//  - hash the key
+//  - compare it with the one key stored in that slot
+// no collisions, no probing, no buckets, and the table is a constexpr object
+// in read-only memory, so nothing has to be constructed at runtime.
+
+// The search ("hash and displace"):
+//  - a first hash distributes the keys over N/2 buckets
+//  - for every bucket, largest first, we try seeds 1, 2, 3, ... for a second
+//    hash until all keys of the bucket land in slots that are still free
+//  - the seed of each bucket is stored, so a lookup is
+//        slot = hash(key, seeds[hash(key, 0) % numBuckets]) % N
+// With N slots for N keys the table is minimal: every slot holds a key.
+
+// Everything is constexpr, so makePerfectHash() runs inside the compiler.
+// If a key is listed twice or no table can be found, the throw makes the
+// constant evaluation, and therefore the compilation, fail.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+
+constexpr std::uint64_t seededHash(std::string_view s, std::uint64_t seed)
+{
+	// FNV-1a with a seeded start value, followed by a 64-bit finalizer
+	// (FNV alone has weak low bits, and the slot is taken modulo N)
+	std::uint64_t h = 0xcbf29ce484222325ull ^ (seed * 0x9E3779B97F4A7C15ull);
+	for (char c : s) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 0x100000001b3ull;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	return h;
+}
+
+template<std::size_t N>
+class PerfectHashTable
+{
+public:
+	static constexpr std::size_t numBuckets = N / 2 + 1;
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	std::array<std::uint32_t, numBuckets> seeds{};
+	std::array<std::string_view, N> keys{};
+
+	// the slot of the key, if the key is one of the N keys
+	// (for other keys, it is the slot of some key)
+	constexpr std::size_t slot(std::string_view key) const {
+		std::uint32_t seed = seeds[seededHash(key, 0) % numBuckets];
+		return seededHash(key, seed) % N;
+	}
+
+	constexpr std::size_t find(std::string_view key) const {
+		if constexpr (N == 0) {
+			return npos;
+		}
+		else {
+			std::size_t i = slot(key);
+			return keys[i] == key ? i : npos;
+		}
+	}
+
+	constexpr bool contains(std::string_view key) const {
+		return find(key) != npos;
+	}
+
+	static constexpr std::size_t size() {
+		return N;
+	}
+};
+
+template<std::size_t N>
+constexpr PerfectHashTable<N> makePerfectHash(std::array<std::string_view, N> const& keys)
+{
+	using Table = PerfectHashTable<N>;
+	Table table{};
+
+	// two equal keys can never land in different slots: reject them before
+	// searching, instead of running into the compiler's evaluation limit
+	std::array<std::string_view, N> sorted = keys;
+	std::sort(sorted.begin(), sorted.end());
+	if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+		throw std::logic_error("duplicate key");
+	}
+
+	// distribute the keys over the buckets
+	// members holds the key indices grouped by bucket (counting sort),
+	// bucket b owns members[first[b]] ... members[first[b + 1] - 1]
+	std::array<std::size_t, N> bucketOf{};
+	std::array<std::size_t, Table::numBuckets + 1> first{};
+	for (std::size_t i = 0; i < N; ++i) {
+		bucketOf[i] = seededHash(keys[i], 0) % Table::numBuckets;
+		++first[bucketOf[i] + 1];
+	}
+	for (std::size_t b = 0; b < Table::numBuckets; ++b) {
+		first[b + 1] += first[b];
+	}
+	std::array<std::size_t, N> members{};
+	std::array<std::size_t, Table::numBuckets> fill{};
+	for (std::size_t i = 0; i < N; ++i) {
+		members[first[bucketOf[i]] + fill[bucketOf[i]]++] = i;
+	}
+
+	// large buckets first: they are the hardest to place
+	std::array<std::size_t, Table::numBuckets> order{};
+	for (std::size_t b = 0; b < Table::numBuckets; ++b) {
+		order[b] = b;
+	}
+	std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		return first[a + 1] - first[a] > first[b + 1] - first[b];
+	});
+
+	std::array<bool, N> taken{};
+	std::array<std::size_t, N> slots{};
+	for (std::size_t b : order) {
+		std::size_t size = first[b + 1] - first[b];
+		if (size == 0) {
+			break;
+		}
+		for (std::uint32_t seed = 1; ; ++seed) {
+			// the keys are distinct, so this takes a few seeds per bucket;
+			// the cap keeps a failure within what the compiler evaluates
+			if (seed > 10'000) {
+				throw std::logic_error("no perfect hash found");
+			}
+			// try to place all keys of bucket b with this seed
+			bool ok = true;
+			for (std::size_t j = 0; j < size && ok; ++j) {
+				std::size_t s = seededHash(keys[members[first[b] + j]], seed) % N;
+				ok = !taken[s] && std::find(slots.begin(), slots.begin() + j, s) == slots.begin() + j;
+				slots[j] = s;
+			}
+			if (ok) {
+				for (std::size_t j = 0; j < size; ++j) {
+					taken[slots[j]] = true;
+					table.keys[slots[j]] = keys[members[first[b] + j]];
+				}
+				table.seeds[b] = seed;
+				break;
+			}
+		}
+	}
+	return table;
+}
+
+
+// hash functor with the same interface as CustomerHash
+// (see variadic_base_classes.cpp), so it can be combined by Overloader<>
+// The table is a template argument (a reference to a constexpr object),
+// so the functor itself is empty and every lookup refers to read-only data.
+template<auto const& Table>
+struct PerfectHash
+{
+	using is_transparent = void;
+
+	std::size_t operator() (std::string_view key) const noexcept {
+		return Table.slot(key);
+	}
+	template<typename T>
+	requires requires (T const& t) { t.getNameView(); }
+	std::size_t operator() (T const& t) const noexcept {
+		return Table.slot(t.getNameView());
+	}
+};
+
+
+// Customer and its functors (a simpler version of the ones in variadic_base_classes.cpp)
+
+#include <string>
+
+struct Customer
+{
+private:
+	std::string name;
+public:
+	Customer(std::string const& n) : name(n) {}
+	std::string getName() const { return name; }
+	std::string_view getNameView() const noexcept { return name; }
+};
+
+struct CustomerEq
+{
+	using is_transparent = void;
+
+	bool operator() (Customer const& c1, Customer const& c2) const
+	{
+		return c1.getNameView() == c2.getNameView();
+	}
+	bool operator() (Customer const& c, std::string_view n) const
+	{
+		return c.getNameView() == n;
+	}
+	bool operator() (std::string_view n, Customer const& c) const
+	{
+		return n == c.getNameView();
+	}
+};
+
+template<typename... Bases>
+struct Overloader : Bases...
+{
+	using Bases::operator()...;
+};
+
+template<typename... Bases>
+struct TransparentOverloader : Overloader<Bases...>
+{
+	using is_transparent = void;
+};
+
+
+// the static allow-list
+constexpr std::array<std::string_view, 8> allowListNames = {
+	"alice", "bob", "carol", "dave", "erin", "frank", "grace", "heidi"
+};
+constexpr auto allowList = makePerfectHash(allowListNames);
+
+static_assert(allowList.contains("carol"));
+static_assert(!allowList.contains("mallory"));
+
+
+#include <iostream>
+#include <unordered_set>
+
+int main()
+{
+	// direct use: one hash and one comparison per lookup
+	Customer c("grace");
+	std::cout << allowList.contains(c.getNameView()) << '\n';     // 1
+
+	// or as functors of a standard container
+	using AllowListOP = TransparentOverloader<PerfectHash<allowList>, CustomerEq>;
+	std::unordered_set<Customer, AllowListOP, AllowListOP> coll;
+	for (std::string_view name : allowListNames) {
+		coll.emplace(std::string(name));
+	}
+	std::cout << coll.contains(std::string_view("bob")) << ' '
+	          << coll.contains(std::string_view("mallory")) << '\n';   // 1 0
+}
@@ -0,0 +1,490 @@
+// Runtime Prime Engine: Miller-Rabin and a Segmented Wheel Sieve
+
+// IsPrime<> and isPrime() of metaprogramming.cpp work for compile-time
+// constants and trial division up to sqrt(p). For 64-bit values that is up to
+// 2^32 divisions per query, and enumerating a range one query at a time is
+// far too slow. Two tools for runtime work:
+
+// 1. isPrime(std::uint64_t): deterministic Miller-Rabin
+//  - n - 1 = d * 2^s; a "witness" a proves n composite unless
+//    a^d = 1 or a^(d*2^r) = -1 (mod n) for some r < s
+//  - for n < 2^64 the seven bases below (found by Jim Sinclair) leave no
+//    composite undetected, so the test is exact, not probabilistic
+//  - the modular multiplications use Montgomery form: a multiplication and a
+//    reduction without any 128-bit division
+//  - it is constexpr, so it also works in static_asserts and template arguments
+
+// 2. primesInRange(lo, hi) / countPrimes(lo, hi): segmented sieve
+//  - the range is cut into segments whose bitmap fits into the L1/L2 cache
+//    (sieving one huge bitmap would miss the cache for every crossed-off bit)
+//  - wheel factorization mod 30: only numbers coprime to 2, 3 and 5 get a bit,
+//    8 of every 30 numbers, so one byte covers 30 numbers, and the multiples
+//    of a prime are visited only at those 8 residues
+//  - the segments are independent, so several threads sieve at once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+namespace prime_detail {
+
+// high and low 64 bits of a * b
+constexpr void mul128(std::uint64_t a, std::uint64_t b, std::uint64_t& hi, std::uint64_t& lo)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+	hi = static_cast<std::uint64_t>(p >> 64);
+	lo = static_cast<std::uint64_t>(p);
+#else
+	std::uint64_t aLo = a & 0xffffffff, aHi = a >> 32;
+	std::uint64_t bLo = b & 0xffffffff, bHi = b >> 32;
+	std::uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+	std::uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+	hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	lo = (mid << 32) | (ll & 0xffffffff);
+#endif
+}
+
+// arithmetic modulo an odd n in Montgomery form (x is stored as x * 2^64 mod n)
+class Montgomery
+{
+private:
+	std::uint64_t n;
+	std::uint64_t nInv = 0;              // n * nInv = 1 (mod 2^64)
+	std::uint64_t r2 = 0;                // 2^128 mod n
+
+	// x * 2^-64 mod n, for x = hi * 2^64 + lo < n * 2^64
+	constexpr std::uint64_t reduce(std::uint64_t hi, std::uint64_t lo) const {
+		std::uint64_t m = lo * nInv;
+		std::uint64_t mnHi = 0, mnLo = 0;
+		mul128(m, n, mnHi, mnLo);        // the low halves of x and m*n are equal
+		return hi >= mnHi ? hi - mnHi : hi - mnHi + n;
+	}
+
+public:
+	constexpr explicit Montgomery(std::uint64_t odd) : n(odd) {
+		// Newton's iteration doubles the number of correct low bits
+		nInv = n;                        // correct to 3 bits for odd n
+		for (int i = 0; i < 5; ++i) {
+			nInv *= 2 - n * nInv;
+		}
+		// 2^64 mod n, then squared (by doubling, as the square needs 128 bits)
+		std::uint64_t r = (0 - n) % n;
+		r2 = r;
+		for (int i = 0; i < 64; ++i) {
+			r2 = r2 >= n - r2 ? r2 - (n - r2) : r2 + r2;
+		}
+	}
+
+	constexpr std::uint64_t mul(std::uint64_t a, std::uint64_t b) const {
+		std::uint64_t hi = 0, lo = 0;
+		mul128(a, b, hi, lo);
+		return reduce(hi, lo);
+	}
+
+	constexpr std::uint64_t to(std::uint64_t a) const {
+		return mul(a % n, r2);
+	}
+
+	constexpr std::uint64_t pow(std::uint64_t base, std::uint64_t e) const {
+		std::uint64_t result = to(1);
+		for (; e != 0; e >>= 1) {
+			if (e & 1) {
+				result = mul(result, base);
+			}
+			base = mul(base, base);
+		}
+		return result;
+	}
+};
+
+}  // namespace prime_detail
+
+
+constexpr bool isPrime(std::uint64_t n)
+{
+	// small primes by trial division (also filters most composites cheaply)
+	constexpr std::uint64_t small[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	if (n < 2) {
+		return false;
+	}
+	for (std::uint64_t p : small) {
+		if (n % p == 0) {
+			return n == p;
+		}
+	}
+	if (n < 41 * 41) {
+		return true;
+	}
+
+	prime_detail::Montgomery mont(n);
+	std::uint64_t d = n - 1;
+	int s = std::countr_zero(d);
+	d >>= s;
+	std::uint64_t one = mont.to(1);
+	std::uint64_t minusOne = mont.to(n - 1);
+
+	constexpr std::uint64_t bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+	for (std::uint64_t a : bases) {
+		if (a % n == 0) {
+			continue;
+		}
+		std::uint64_t x = mont.pow(mont.to(a), d);
+		if (x == one || x == minusOne) {
+			continue;
+		}
+		bool witness = true;
+		for (int r = 1; r < s && witness; ++r) {
+			x = mont.mul(x, x);
+			witness = x != minusOne;
+		}
+		if (witness) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(isPrime(2) && isPrime(97) && !isPrime(561));          // 561: Carmichael number
+static_assert(isPrime(18446744073709551557ull));                     // the largest 64-bit prime
+static_assert(!isPrime(3825123056546413051ull));                     // a strong pseudoprime to bases 2..23
+
+
+namespace prime_detail {
+
+// the wheel: residues mod 30 coprime to 30, one bit each
+constexpr std::array<std::uint8_t, 8> wheel = {1, 7, 11, 13, 17, 19, 23, 29};
+constexpr std::array<std::uint8_t, 8> wheelGap = {6, 4, 2, 4, 2, 4, 6, 2};
+
+// residue mod 30 -> bit (or -1)
+constexpr std::array<std::int8_t, 30> bitOf = [] {
+	std::array<std::int8_t, 30> t{};
+	t.fill(-1);
+	for (std::size_t i = 0; i < wheel.size(); ++i) {
+		t[wheel[i]] = static_cast<std::int8_t>(i);
+	}
+	return t;
+}();
+
+// residue mod 30 -> distance to the next residue on the wheel
+constexpr std::array<std::uint8_t, 30> nextDist = [] {
+	std::array<std::uint8_t, 30> t{};
+	for (int r = 0; r < 30; ++r) {
+		int d = 0;
+		while (bitOf[(r + d) % 30] < 0) {
+			++d;
+		}
+		t[r] = static_cast<std::uint8_t>(d);
+	}
+	return t;
+}();
+
+// a 32 KiB segment bitmap (L1 data cache) covers 30 * 32768 numbers
+constexpr std::size_t segmentBytes = 32 * 1024;
+constexpr std::uint64_t segmentSpan = 30 * segmentBytes;
+
+// the segments are sieved in chunks of up to 64 (a 2 MiB bitmap)
+constexpr std::uint64_t chunkSegments = 64;
+
+// sieving primes up to 2^20 are kept in a vector; the larger ones (needed for
+// hi > 2^40) are sieved segment by segment themselves, as all primes up to
+// 2^32 would take 800 MB
+constexpr std::uint64_t smallPrimeLimit = std::uint64_t(1) << 20;
+
+// the primes from 7 to limit (simple odd-only sieve)
+inline std::vector<std::uint32_t> sievingPrimes(std::uint64_t limit)
+{
+	std::vector<bool> composite(limit / 2 + 1);
+	std::vector<std::uint32_t> primes;
+	for (std::uint64_t p = 3; p <= limit; p += 2) {
+		if (!composite[p / 2]) {
+			if (p >= 7) {
+				primes.push_back(static_cast<std::uint32_t>(p));
+			}
+			for (std::uint64_t m = p * p; m <= limit; m += 2 * p) {
+				composite[m / 2] = true;
+			}
+		}
+	}
+	return primes;
+}
+
+inline std::uint64_t isqrt(std::uint64_t n)
+{
+	auto r = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(n)));
+	while (r > 0 && r > n / r) {
+		--r;
+	}
+	while ((r + 1) <= n / (r + 1)) {
+		++r;
+	}
+	return r;
+}
+
+// the number of segments from base (a multiple of 30) to hi, without
+// overflow for hi close to 2^64
+inline std::uint64_t segmentCount(std::uint64_t base, std::uint64_t hi)
+{
+	return (hi - base) / segmentSpan + ((hi - base) % segmentSpan != 0);
+}
+
+// the end of the segment starting at segLo (segLo + segmentSpan may overflow)
+inline std::uint64_t segmentEnd(std::uint64_t segLo, std::uint64_t hi)
+{
+	return hi - segLo <= segmentSpan ? hi : segLo + segmentSpan;
+}
+
+// crosses off the multiples p * k (k >= p, k coprime to 30) in [segLo, segHi);
+// Clear(byte, mask) clears the bits of mask in the bitmap starting at segLo
+template<typename Clear>
+inline void crossOff(std::uint64_t p, std::uint64_t segLo, std::uint64_t segHi, Clear const& clear)
+{
+	std::uint64_t q = segLo / p;
+	std::uint64_t r = segLo - q * p;
+	std::uint64_t k = q + (r != 0);
+	if (k < p) {
+		k = p;
+	}
+	else if (r != 0 && p - r >= segHi - segLo) {
+		return;                          // no multiple at all (most large primes)
+	}
+	k += nextDist[k % 30];
+	std::uint64_t kMax = (segHi - 1) / p;
+	unsigned i = static_cast<unsigned>(bitOf[k % 30]);
+	for (; k <= kMax; k += wheelGap[i], i = (i + 1) & 7) {
+		std::uint64_t rel = p * k - segLo;
+		clear(rel / 30, static_cast<std::uint8_t>(~(1u << bitOf[rel % 30])));
+	}
+}
+
+// sieves the segment [segLo, segHi) (segLo a multiple of 30) with the
+// primes of small into bytes, keeping only numbers >= lo; returns the
+// number of bytes used
+inline std::size_t sieveSegment(std::uint8_t* bytes, std::uint64_t segLo, std::uint64_t segHi, std::uint64_t lo,
+                                std::vector<std::uint32_t> const& small)
+{
+	std::size_t numBytes = static_cast<std::size_t>((segHi - segLo + 29) / 30);
+	std::fill_n(bytes, numBytes, std::uint8_t(0xff));
+	for (std::uint32_t p : small) {
+		if (std::uint64_t(p) * p >= segHi) {
+			break;
+		}
+		crossOff(p, segLo, segHi, [&](std::uint64_t b, std::uint8_t mask) {
+			bytes[b] &= mask;
+		});
+	}
+	// clear the bits outside of [lo, segHi) (and 1, which is not prime);
+	// the last byte may reach past 2^64, so compare offsets
+	auto clear = [&](std::size_t b) {
+		for (unsigned bit = 0; bit < 8; ++bit) {
+			std::uint64_t offset = 30 * b + wheel[bit];
+			if (offset >= segHi - segLo || segLo + offset < lo || segLo + offset == 1) {
+				bytes[b] &= static_cast<std::uint8_t>(~(1u << bit));
+			}
+		}
+	};
+	clear(0);
+	clear(numBytes - 1);
+	return numBytes;
+}
+
+// calls f(0) ... f(count - 1) on numThreads threads
+template<typename F>
+void forEachParallel(unsigned numThreads, std::uint64_t count, F const& f)
+{
+	std::atomic<std::uint64_t> next{0};
+	auto work = [&] {
+		for (;;) {
+			std::uint64_t i = next.fetch_add(1, std::memory_order_relaxed);
+			if (i >= count) {
+				return;
+			}
+			f(i);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned t = 1; t < std::min<std::uint64_t>(numThreads, count); ++t) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (auto& t : threads) {
+		t.join();
+	}
+}
+
+// sieves [lo, hi) in segments on numThreads threads;
+// onSegment(index, segLo, bytes, numBytes) gets the bitmap of each segment,
+// with exactly the primes in [lo, hi) set (other than 2, 3 and 5)
+template<typename F>
+void sieveSegments(std::uint64_t lo, std::uint64_t hi, unsigned numThreads, F const& onSegment)
+{
+	if (hi <= lo) {
+		return;
+	}
+	numThreads = std::max(1u, numThreads);
+	std::uint64_t base = lo / 30 * 30;
+	std::uint64_t numSegments = segmentCount(base, hi);
+	std::uint64_t limit = isqrt(hi - 1);
+	std::vector<std::uint32_t> small = sievingPrimes(std::min(limit, smallPrimeLimit));
+	std::vector<std::uint8_t> bitmap(std::min(numSegments, chunkSegments) * segmentBytes);
+
+	for (std::uint64_t first = 0; first < numSegments; first += chunkSegments) {
+		std::uint64_t count = std::min(chunkSegments, numSegments - first);
+		std::uint64_t chunkLo = base + first * segmentSpan;
+		std::uint64_t chunkHi = hi - chunkLo <= count * segmentSpan ? hi : chunkLo + count * segmentSpan;
+
+		// 1. the small primes, one segment at a time (it stays in the L1 cache)
+		forEachParallel(numThreads, count, [&](std::uint64_t s) {
+			std::uint64_t segLo = chunkLo + s * segmentSpan;
+			sieveSegment(bitmap.data() + s * segmentBytes, segLo, segmentEnd(segLo, hi), lo, small);
+		});
+
+		// 2. the large primes, a block of sieving primes at a time; a large
+		// prime hits a segment at most a few times, so the threads share the
+		// bitmap of the whole chunk and clear bits atomically
+		std::uint64_t chunkLimit = isqrt(chunkHi - 1);
+		if (chunkLimit > smallPrimeLimit) {
+			std::uint64_t numBlocks = segmentCount(smallPrimeLimit / 30 * 30, chunkLimit + 1);
+			forEachParallel(numThreads, numBlocks, [&](std::uint64_t blk) {
+				thread_local std::vector<std::uint8_t> bytes(segmentBytes);
+				std::uint64_t blockLo = smallPrimeLimit / 30 * 30 + blk * segmentSpan;
+				std::uint64_t blockHi = std::min(blockLo + segmentSpan, chunkLimit + 1);
+				std::size_t numBytes = sieveSegment(bytes.data(), blockLo, blockHi, smallPrimeLimit + 1, small);
+				for (std::size_t b = 0; b < numBytes; ++b) {
+					for (unsigned bits = bytes[b]; bits != 0; bits &= bits - 1) {
+						std::uint64_t p = blockLo + 30 * b + wheel[std::countr_zero(bits)];
+						crossOff(p, chunkLo, chunkHi, [&](std::uint64_t i, std::uint8_t mask) {
+							std::atomic_ref<std::uint8_t>(bitmap[i]).fetch_and(mask, std::memory_order_relaxed);
+						});
+					}
+				}
+			});
+		}
+
+		// 3. the finished segments
+		forEachParallel(numThreads, count, [&](std::uint64_t s) {
+			std::uint64_t segLo = chunkLo + s * segmentSpan;
+			std::uint64_t segHi = segmentEnd(segLo, hi);
+			std::size_t numBytes = static_cast<std::size_t>((segHi - segLo + 29) / 30);
+			onSegment(first + s, segLo, bitmap.data() + s * segmentBytes, numBytes);
+		});
+	}
+}
+
+inline unsigned defaultThreads()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+}  // namespace prime_detail
+
+
+// the number of primes in [lo, hi)
+inline std::uint64_t countPrimes(std::uint64_t lo, std::uint64_t hi,
+                                 unsigned numThreads = prime_detail::defaultThreads())
+{
+	std::uint64_t count = 0;
+	for (std::uint64_t p : {2, 3, 5}) {
+		count += lo <= p && p < hi;
+	}
+	std::atomic<std::uint64_t> total{0};
+	prime_detail::sieveSegments(lo, hi, numThreads,
+		[&](std::uint64_t, std::uint64_t, std::uint8_t const* bytes, std::size_t numBytes) {
+			std::uint64_t c = 0;
+			for (std::size_t b = 0; b < numBytes; ++b) {
+				c += std::popcount(bytes[b]);
+			}
+			total.fetch_add(c, std::memory_order_relaxed);
+		});
+	return count + total.load();
+}
+
+// all primes in [lo, hi), in ascending order
+inline std::vector<std::uint64_t> primesInRange(std::uint64_t lo, std::uint64_t hi,
+                                                unsigned numThreads = prime_detail::defaultThreads())
+{
+	using namespace prime_detail;
+	std::vector<std::uint64_t> result;
+	for (std::uint64_t p : {2, 3, 5}) {
+		if (lo <= p && p < hi) {
+			result.push_back(p);
+		}
+	}
+	if (hi <= lo) {
+		return result;
+	}
+	// every segment collects its own primes, concatenated in order at the end
+	std::uint64_t base = lo / 30 * 30;
+	std::vector<std::vector<std::uint64_t>> perSegment(segmentCount(base, hi));
+	sieveSegments(lo, hi, numThreads,
+		[&](std::uint64_t seg, std::uint64_t segLo, std::uint8_t const* bytes, std::size_t numBytes) {
+			auto& out = perSegment[seg];
+			for (std::size_t b = 0; b < numBytes; ++b) {
+				for (unsigned bits = bytes[b]; bits != 0; bits &= bits - 1) {
+					out.push_back(segLo + 30 * b + wheel[std::countr_zero(bits)]);
+				}
+			}
+		});
+	for (auto const& seg : perSegment) {
+		result.insert(result.end(), seg.begin(), seg.end());
+	}
+	return result;
+}
+
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+
+int main()
+{
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	auto t0 = Clock::now();
+	std::uint64_t pi = countPrimes(0, 1'000'000'000);
+	auto t1 = Clock::now();
+	std::cout << "pi(10^9) = " << pi << " in " << ms(t1 - t0) << " ms\n";     // 50847534
+
+	std::vector<std::uint64_t> primes = primesInRange(1'000'000'000'000, 1'000'000'001'000);
+	std::cout << primes.size() << " primes in [10^12, 10^12 + 1000), first "
+	          << primes.front() << '\n';
+
+	// the last numbers below 2^64: the segment ends must not overflow, and
+	// the sieving primes up to 2^32 are generated block by block
+	constexpr std::uint64_t top = std::numeric_limits<std::uint64_t>::max();
+	auto t4 = Clock::now();
+	std::vector<std::uint64_t> high = primesInRange(top - 100'000, top);
+	auto t5 = Clock::now();
+	std::size_t expected = 0;
+	for (std::uint64_t x = top - 100'000; x < top; ++x) {
+		expected += isPrime(x);
+	}
+	bool ok = high.size() == expected && std::all_of(high.begin(), high.end(), [](std::uint64_t x) {
+		return isPrime(x);
+	});
+	std::cout << high.size() << " primes in [2^64 - 1 - 10^5, 2^64 - 1) in " << ms(t5 - t4) << " ms"
+	          << (ok ? "" : " MISMATCH") << '\n';                           // 2139
+
+	// hash-table sizing: the next prime after a requested size
+	std::mt19937_64 rnd(42);
+	constexpr std::size_t n = 10'000'000;
+	std::size_t found = 0;
+	auto t2 = Clock::now();
+	for (std::size_t i = 0; i < n; ++i) {
+		found += isPrime(rnd() | 1);
+	}
+	auto t3 = Clock::now();
+	std::cout << n << " random 64-bit Miller-Rabin tests in " << ms(t3 - t2) << " ms ("
+	          << found << " primes)\n";
+}
@@ -0,0 +1,454 @@
+// Prime-sized Hash Tables with Fastmod
+
+// A hash table maps a hash value h to one of n buckets. The two usual choices:
+//  - n is a power of two: bucket = h & (n - 1), a single AND
+//    but only the lowest bits of h are used, so a poor hash function whose low
+//    bits don't vary (e.g. ids multiplied by 256, or addresses of aligned
+//    objects) puts all elements into a few buckets
+//  - n is a prime: bucket = h % n, every bit of h affects the bucket,
+//    so such patterns are spread out; this is what std::unordered_set of
+//    libstdc++ does, but the division takes 20 to 40+ cycles
+// (execution_path_selection.cpp already selects code paths by isPrime(sz).)
+
+// Lemire's fastmod computes a % d for 32-bit a and d without a division:
+//    M = 2^64 / d + 1   (rounded down, computed once per d)
+//    a % d = ((M * a mod 2^64) * d) >> 64
+// two multiplications, and M only depends on the table size. So the table
+// sizes are taken from a list of primes computed at compile time, each with
+// its M, and growing the table just moves to the next entry.
+
+// PrimeHashSet<> takes the hash and equality functors of std::unordered_set<>
+// (like the ones for Customer in variadic_base_classes.cpp, also combined by
+// Overloader<>) and a size policy, which turns a hash into a bucket index:
+//  - PrimeSizePolicy:      prime sizes, fastmod (the default)
+//  - ModuloSizePolicy:     prime sizes, %
+//  - PowerOfTwoSizePolicy: power-of-two sizes, mask
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+constexpr bool isPrime(std::uint32_t p)
+{
+	if (p < 4) {
+		return p > 1;
+	}
+	if (p % 2 == 0 || p % 3 == 0) {
+		return false;
+	}
+	for (std::uint32_t d = 5; d <= p / d; d += 6) {
+		if (p % d == 0 || p % (d + 2) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct PrimeSize
+{
+	std::uint32_t prime;
+	std::uint64_t fastmodM;              // 2^64 / prime + 1
+};
+
+// the bucket counts: the next prime after 2^k and after 1.5 * 2^k,
+// so each step grows the table by a factor of about 1.33 to 1.5
+constexpr auto primeSizes = [] {
+	std::array<PrimeSize, 2 * 29> sizes{};
+	std::size_t i = 0;
+	for (unsigned k = 3; k <= 31; ++k) {
+		for (std::uint64_t n : {std::uint64_t(1) << k, (std::uint64_t(3) << k) / 2}) {
+			auto p = static_cast<std::uint32_t>(n);
+			while (!isPrime(p)) {
+				++p;
+			}
+			sizes[i++] = PrimeSize{p, ~std::uint64_t(0) / p + 1};
+		}
+	}
+	return sizes;
+}();
+
+static_assert(primeSizes.front().prime == 11 && primeSizes.back().prime == 3221225473u);
+
+// high 64 bits of a * b for a 32-bit b (portable, no 128-bit type needed)
+constexpr std::uint64_t mulHi(std::uint64_t a, std::uint32_t b)
+{
+	return ((a >> 32) * b + (((a & 0xffffffff) * b) >> 32)) >> 32;
+}
+
+constexpr std::uint32_t fastmod(std::uint32_t a, PrimeSize const& d)
+{
+	return static_cast<std::uint32_t>(mulHi(d.fastmodM * a, d.prime));
+}
+
+static_assert(fastmod(1'000'003, primeSizes[5]) == 1'000'003 % primeSizes[5].prime);
+
+// a 64-bit hash folded to the 32 bits fastmod works on
+constexpr std::uint32_t fold(std::uint64_t h)
+{
+	return static_cast<std::uint32_t>(h ^ (h >> 32));
+}
+
+
+class PrimeSizePolicy
+{
+private:
+	std::size_t idx = 0;
+public:
+	std::size_t bucketCount() const { return primeSizes[idx].prime; }
+
+	// selects the smallest size >= minBuckets
+	void resize(std::size_t minBuckets) {
+		idx = 0;
+		while (idx + 1 < primeSizes.size() && primeSizes[idx].prime < minBuckets) {
+			++idx;
+		}
+	}
+
+	// the next size of the list (about 1.33 to 1.5 times larger)
+	void grow() {
+		idx = std::min(idx + 1, primeSizes.size() - 1);
+	}
+
+	std::size_t bucket(std::size_t h) const {
+		return fastmod(fold(h), primeSizes[idx]);
+	}
+};
+
+class ModuloSizePolicy
+{
+private:
+	std::size_t idx = 0;
+public:
+	std::size_t bucketCount() const { return primeSizes[idx].prime; }
+
+	void resize(std::size_t minBuckets) {
+		idx = 0;
+		while (idx + 1 < primeSizes.size() && primeSizes[idx].prime < minBuckets) {
+			++idx;
+		}
+	}
+
+	void grow() {
+		idx = std::min(idx + 1, primeSizes.size() - 1);
+	}
+
+	std::size_t bucket(std::size_t h) const {
+		return fold(h) % primeSizes[idx].prime;
+	}
+};
+
+class PowerOfTwoSizePolicy
+{
+private:
+	std::size_t mask = 7;
+public:
+	std::size_t bucketCount() const { return mask + 1; }
+
+	void resize(std::size_t minBuckets) {
+		std::size_t n = 8;
+		while (n < minBuckets) {
+			n *= 2;
+		}
+		mask = n - 1;
+	}
+
+	void grow() {
+		mask = 2 * mask + 1;
+	}
+
+	std::size_t bucket(std::size_t h) const {
+		return h & mask;
+	}
+};
+
+
+// a chained hash set: the elements live in one vector,
+// and the buckets and chains are 32-bit indices into it
+template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>,
+         typename SizePolicy = PrimeSizePolicy>
+class PrimeHashSet
+{
+private:
+	static constexpr std::uint32_t npos = static_cast<std::uint32_t>(-1);
+
+	struct Node {
+		T value;
+		std::uint32_t next;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<std::uint32_t> heads;
+	SizePolicy policy;
+	Hash hash;
+	KeyEqual eq;
+
+	template<typename K>
+	static constexpr bool isTransparent = !std::is_same_v<K, T>
+	                                      && requires { typename Hash::is_transparent;
+	                                                    typename KeyEqual::is_transparent; };
+
+	template<typename K>
+	std::uint32_t findIndex(K const& key) const {
+		std::uint32_t i = heads[policy.bucket(hash(key))];
+		while (i != npos && !eq(nodes[i].value, key)) {
+			i = nodes[i].next;
+		}
+		return i;
+	}
+
+	void rehash(std::size_t minBuckets) {
+		policy.resize(minBuckets);
+		rebuild();
+	}
+
+	// relinks all elements for the current size of the policy
+	void rebuild() {
+		heads.assign(policy.bucketCount(), npos);
+		for (std::uint32_t i = 0; i < nodes.size(); ++i) {
+			std::uint32_t& head = heads[policy.bucket(hash(nodes[i].value))];
+			nodes[i].next = head;
+			head = i;
+		}
+	}
+
+public:
+	PrimeHashSet() {
+		heads.assign(policy.bucketCount(), npos);
+	}
+
+	std::size_t size() const { return nodes.size(); }
+	bool empty() const { return nodes.empty(); }
+	std::size_t bucket_count() const { return heads.size(); }
+
+	void reserve(std::size_t n) {
+		if (n > heads.size()) {
+			rehash(n);
+		}
+	}
+
+	// returns the element and whether it was inserted
+	template<typename... Args>
+	std::pair<T const*, bool> emplace(Args&&... args) {
+		T value(std::forward<Args>(args)...);
+		if (std::uint32_t i = findIndex(value); i != npos) {
+			return {&nodes[i].value, false};
+		}
+		if (nodes.size() + 1 > heads.size()) {       // max. load factor 1
+			policy.grow();
+			rebuild();
+		}
+		assert(nodes.size() < npos);                 // the indices are 32-bit
+		auto i = static_cast<std::uint32_t>(nodes.size());
+		std::uint32_t& head = heads[policy.bucket(hash(value))];
+		nodes.push_back(Node{std::move(value), head});
+		head = i;
+		return {&nodes[i].value, true};
+	}
+
+	std::pair<T const*, bool> insert(T const& value) {
+		return emplace(value);
+	}
+
+	T const* find(T const& key) const {
+		std::uint32_t i = findIndex(key);
+		return i == npos ? nullptr : &nodes[i].value;
+	}
+
+	template<typename K>
+	requires isTransparent<K>
+	T const* find(K const& key) const {
+		std::uint32_t i = findIndex(key);
+		return i == npos ? nullptr : &nodes[i].value;
+	}
+
+	bool contains(T const& key) const { return find(key) != nullptr; }
+
+	template<typename K>
+	requires isTransparent<K>
+	bool contains(K const& key) const { return find(key) != nullptr; }
+
+	// the last element moves into the hole, so the vector stays dense
+	std::size_t erase(T const& key) {
+		std::uint32_t* link = &heads[policy.bucket(hash(key))];
+		while (*link != npos && !eq(nodes[*link].value, key)) {
+			link = &nodes[*link].next;
+		}
+		if (*link == npos) {
+			return 0;
+		}
+		std::uint32_t i = *link;
+		*link = nodes[i].next;
+		auto last = static_cast<std::uint32_t>(nodes.size() - 1);
+		if (i != last) {
+			std::uint32_t* toLast = &heads[policy.bucket(hash(nodes[last].value))];
+			while (*toLast != last) {
+				toLast = &nodes[*toLast].next;
+			}
+			*toLast = i;
+			nodes[i] = std::move(nodes[last]);
+		}
+		nodes.pop_back();
+		return 1;
+	}
+
+	template<typename F>
+	void forEach(F f) const {
+		for (Node const& n : nodes) {
+			f(n.value);
+		}
+	}
+
+	// the length of the longest chain (1 for a perfect distribution)
+	std::size_t maxChain() const {
+		std::size_t longest = 0;
+		for (std::uint32_t head : heads) {
+			std::size_t len = 0;
+			for (std::uint32_t i = head; i != npos; i = nodes[i].next) {
+				++len;
+			}
+			longest = std::max(longest, len);
+		}
+		return longest;
+	}
+};
+
+
+// Customer and its functors (a simpler version of the ones in variadic_base_classes.cpp)
+
+#include <string>
+#include <string_view>
+
+struct Customer
+{
+private:
+	std::string name;
+public:
+	Customer(std::string const& n) : name(n) {}
+	std::string getName() const { return name; }
+	std::string_view getNameView() const noexcept { return name; }
+};
+
+struct CustomerEq
+{
+	using is_transparent = void;
+
+	bool operator() (Customer const& c1, Customer const& c2) const
+	{
+		return c1.getNameView() == c2.getNameView();
+	}
+	bool operator() (Customer const& c, std::string_view n) const
+	{
+		return c.getNameView() == n;
+	}
+	bool operator() (std::string_view n, Customer const& c) const
+	{
+		return n == c.getNameView();
+	}
+};
+
+struct CustomerHash
+{
+	using is_transparent = void;
+
+	std::size_t operator() (Customer const& c) const {
+		return std::hash<std::string_view>()(c.getNameView());
+	}
+	std::size_t operator() (std::string_view n) const {
+		return std::hash<std::string_view>()(n);
+	}
+};
+
+template<typename... Bases>
+struct Overloader : Bases...
+{
+	using Bases::operator()...;
+};
+
+template<typename... Bases>
+struct TransparentOverloader : Overloader<Bases...>
+{
+	using is_transparent = void;
+};
+
+// a poor hash: the number in "customer#<n>", times 256
+// (all values are multiples of 256, so the low 8 bits are always 0)
+struct CustomerIdHash
+{
+	std::size_t operator() (Customer const& c) const {
+		std::string_view n = c.getNameView();
+		std::size_t id = 0;
+		for (char ch : n.substr(n.find('#') + 1)) {
+			id = id * 10 + static_cast<std::size_t>(ch - '0');
+		}
+		return id * 256;
+	}
+};
+
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+int main()
+{
+	using CustomerOP = TransparentOverloader<CustomerHash, CustomerEq>;
+
+	PrimeHashSet<Customer, CustomerOP, CustomerOP> coll;
+	coll.insert(Customer("nico"));
+	coll.emplace("tim");
+	std::cout << coll.contains(std::string_view("nico")) << ' ' << coll.bucket_count() << '\n';   // 1 11
+
+	// the poor hash with power-of-two and prime sizes
+	PrimeHashSet<Customer, CustomerIdHash, CustomerEq, PowerOfTwoSizePolicy> pow2Set;
+	PrimeHashSet<Customer, CustomerIdHash, CustomerEq, PrimeSizePolicy> primeSet;
+	for (int i = 0; i < 100'000; ++i) {
+		pow2Set.emplace("customer#" + std::to_string(i));
+		primeSet.emplace("customer#" + std::to_string(i));
+	}
+	std::cout << "longest chain, power of two: " << pow2Set.maxChain()
+	          << ", prime: " << primeSet.maxChain() << '\n';              // 196, 1
+
+	// lookups: the cost of the reduction itself
+	// (cheap keys, a good hash, and a table that fits into the cache)
+	struct MixHash {
+		std::size_t operator() (std::uint64_t x) const {
+			x ^= x >> 33;
+			x *= 0xff51afd7ed558ccdull;
+			return static_cast<std::size_t>(x ^ (x >> 33));
+		}
+	};
+	constexpr std::size_t n = 20'000;
+	std::mt19937_64 rnd(42);
+	std::vector<std::uint64_t> keys(n);
+	for (auto& k : keys) {
+		k = rnd();
+	}
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+	auto measure = [&](char const* name, auto set) {
+		for (std::uint64_t k : keys) {
+			set.insert(k);
+		}
+		auto t0 = Clock::now();
+		std::size_t hits = 0;
+		for (int round = 0; round < 500; ++round) {
+			for (std::uint64_t k : keys) {
+				hits += set.contains(k + (round & 1));
+			}
+		}
+		std::cout << name << ms(Clock::now() - t0) << " ms (" << hits << " hits)\n";
+	};
+	measure("prime, fastmod: ", PrimeHashSet<std::uint64_t, MixHash, std::equal_to<>, PrimeSizePolicy>());
+	measure("prime, %:       ", PrimeHashSet<std::uint64_t, MixHash, std::equal_to<>, ModuloSizePolicy>());
+	measure("power of two:   ", PrimeHashSet<std::uint64_t, MixHash, std::equal_to<>, PowerOfTwoSizePolicy>());
+}
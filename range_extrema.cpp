@@ -0,0 +1,361 @@
+// Vectorized Extrema over Ranges
+
+// The ::max() templates of function_templates.cpp take two values and compute
+// the type of the result from both argument types (std::common_type_t<T1, T2>,
+// or the decayed type of operator ?:). The functions here do the same for
+// whole ranges:
+//     range::max(ints)              // int
+//     range::max(ints, doubles)     // std::common_type_t<int, double>: double
+//     range::minmax(...)            // std::pair of both, in one pass
+//     range::argmax(doubles)        // position of the first maximum
+// Each range is reduced in its own element type, and only the results are
+// converted to the common type, like the arguments of ::max(a, b).
+
+// For contiguous ranges of arithmetic types the reduction is vectorized:
+//  - a single running maximum is one long dependency chain, and the compiler
+//    must not reorder it for floating-point values (see array_reductions.cpp)
+//  - instead, 64 bytes worth of independent "lanes" each keep their own
+//    maximum (16 floats, 8 doubles, 64 chars): element i goes to lane i % W,
+//    and the lane updates of one step are a single SIMD max on the
+//    registers, combined once at the end
+//  - inputs of more than parallelThreshold elements are split into one chunk
+//    per hardware thread, and the results of the chunks are combined
+// Other ranges take the ordinary loop.
+// The comparisons use operator< only, like ::max(); for NaNs the result is
+// unspecified (as for std::max_element with a NaN).
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <future>
+#include <iterator>
+#include <ranges>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace range {
+
+namespace detail {
+
+constexpr std::size_t parallelThreshold = 1 << 20;
+
+template<typename T>
+constexpr std::size_t lanes = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+
+// true if x replaces cur: greater for max, less for min
+// (strict, so the first of several equal extrema wins)
+struct Greater {
+    template<typename T>
+    bool operator() (T const& x, T const& cur) const { return cur < x; }
+};
+
+struct Less {
+    template<typename T>
+    bool operator() (T const& x, T const& cur) const { return x < cur; }
+};
+
+// extremum of p[0], ..., p[n-1] (n > 0) with one accumulator per lane
+template<typename T, typename Better>
+T extremumLanes(T const* p, std::size_t n, Better better)
+{
+    constexpr std::size_t W = lanes<T>;
+    if (n < W) {
+        T result = p[0];
+        for (std::size_t i = 1; i < n; ++i) {
+            result = better(p[i], result) ? p[i] : result;
+        }
+        return result;
+    }
+    T acc[W];
+    std::copy(p, p + W, acc);
+    std::size_t i = W;
+    for (; i + W <= n; i += W) {
+        for (std::size_t j = 0; j < W; ++j) {
+            acc[j] = better(p[i + j], acc[j]) ? p[i + j] : acc[j];
+        }
+    }
+    for (; i < n; ++i) {
+        acc[0] = better(p[i], acc[0]) ? p[i] : acc[0];
+    }
+    T result = acc[0];
+    for (std::size_t j = 1; j < W; ++j) {
+        result = better(acc[j], result) ? acc[j] : result;
+    }
+    return result;
+}
+
+// minimum and maximum in one pass
+template<typename T>
+std::pair<T, T> minmaxLanes(T const* p, std::size_t n)
+{
+    constexpr std::size_t W = lanes<T>;
+    if (n < W) {
+        return {extremumLanes(p, n, Less{}), extremumLanes(p, n, Greater{})};
+    }
+    T lo[W];
+    T hi[W];
+    std::copy(p, p + W, lo);
+    std::copy(p, p + W, hi);
+    std::size_t i = W;
+    for (; i + W <= n; i += W) {
+        for (std::size_t j = 0; j < W; ++j) {
+            lo[j] = p[i + j] < lo[j] ? p[i + j] : lo[j];
+            hi[j] = hi[j] < p[i + j] ? p[i + j] : hi[j];
+        }
+    }
+    T rlo = extremumLanes(lo, W, Less{});
+    T rhi = extremumLanes(hi, W, Greater{});
+    for (; i < n; ++i) {
+        rlo = p[i] < rlo ? p[i] : rlo;
+        rhi = rhi < p[i] ? p[i] : rhi;
+    }
+    return {rlo, rhi};
+}
+
+// the first maximum and its position, in blocks that stay in the L1 cache:
+// the maximum of a block is found with the lanes, and only a block that
+// improves the result is searched again for the position
+template<typename T>
+std::pair<T, std::size_t> argmaxBlocks(T const* p, std::size_t n)
+{
+    constexpr std::size_t block = 4096;
+    T best = p[0];
+    std::size_t bestPos = 0;
+    for (std::size_t b = 0; b < n; b += block) {
+        std::size_t len = std::min(block, n - b);
+        T m = extremumLanes(p + b, len, Greater{});
+        if (best < m) {
+            std::size_t pos = std::find(p + b, p + b + len, m) - p;
+            if (pos < b + len) {
+                best = m;
+                bestPos = pos;
+            }
+        }
+    }
+    return {best, bestPos};
+}
+
+// runs f(first, count) on chunks of [0, n) in parallel and returns the results
+template<typename F>
+auto forChunks(std::size_t n, F f)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::future<decltype(f(std::size_t(0), n))>> parts;
+    for (std::size_t first = chunk; first < n; first += chunk) {
+        parts.push_back(std::async(std::launch::async, f, first, std::min(chunk, n - first)));
+    }
+    std::vector<decltype(f(std::size_t(0), n))> results{f(0, std::min(chunk, n))};
+    for (auto& part : parts) {
+        results.push_back(part.get());
+    }
+    return results;
+}
+
+template<typename R>
+constexpr bool vectorizable = std::ranges::contiguous_range<R>
+                              && std::is_arithmetic_v<std::ranges::range_value_t<R>>;
+
+template<typename R, typename Better>
+std::ranges::range_value_t<R> extremum(R const& r, Better better)
+{
+    using T = std::ranges::range_value_t<R>;
+    if constexpr (vectorizable<R>) {
+        T const* p = std::ranges::data(r);
+        std::size_t n = std::ranges::size(r);
+        if (n < parallelThreshold) {
+            return extremumLanes(p, n, better);
+        }
+        auto parts = forChunks(n, [=](std::size_t first, std::size_t count) {
+            return extremumLanes(p + first, count, better);
+        });
+        return extremumLanes(parts.data(), parts.size(), better);
+    }
+    else {
+        auto pos = std::ranges::begin(r);
+        T result = *pos;
+        for (++pos; pos != std::ranges::end(r); ++pos) {
+            if (better(*pos, result)) {
+                result = *pos;
+            }
+        }
+        return result;
+    }
+}
+
+template<typename R>
+std::pair<std::ranges::range_value_t<R>, std::ranges::range_value_t<R>> minmaxOf(R const& r)
+{
+    using T = std::ranges::range_value_t<R>;
+    if constexpr (vectorizable<R>) {
+        T const* p = std::ranges::data(r);
+        std::size_t n = std::ranges::size(r);
+        if (n < parallelThreshold) {
+            return minmaxLanes(p, n);
+        }
+        auto parts = forChunks(n, [=](std::size_t first, std::size_t count) {
+            return minmaxLanes(p + first, count);
+        });
+        std::pair<T, T> result = parts[0];
+        for (auto const& [lo, hi] : parts) {
+            result.first = lo < result.first ? lo : result.first;
+            result.second = result.second < hi ? hi : result.second;
+        }
+        return result;
+    }
+    else {
+        return {extremum(r, Less{}), extremum(r, Greater{})};
+    }
+}
+
+template<typename... Rs>
+using CommonValue = std::common_type_t<std::ranges::range_value_t<Rs>...>;
+
+// combines the results of several ranges in the common type,
+// skipping empty ranges
+template<typename CT, typename Better, typename... Rs>
+CT combine(Better better, Rs const&... ranges)
+{
+    bool any = false;
+    CT result{};
+    auto take = [&](auto const& r) {
+        if (!std::ranges::empty(r)) {
+            CT v = static_cast<CT>(extremum(r, better));
+            if (!any || better(v, result)) {
+                result = v;
+            }
+            any = true;
+        }
+    };
+    (take(ranges), ...);
+    assert(any && "all ranges are empty");
+    return result;
+}
+
+}  // namespace detail
+
+
+// the largest element of all ranges (at least one element in total)
+template<std::ranges::forward_range... Rs>
+requires (sizeof...(Rs) > 0)
+detail::CommonValue<Rs...> max(Rs const&... ranges)
+{
+    return detail::combine<detail::CommonValue<Rs...>>(detail::Greater{}, ranges...);
+}
+
+// the smallest element of all ranges (at least one element in total)
+template<std::ranges::forward_range... Rs>
+requires (sizeof...(Rs) > 0)
+detail::CommonValue<Rs...> min(Rs const&... ranges)
+{
+    return detail::combine<detail::CommonValue<Rs...>>(detail::Less{}, ranges...);
+}
+
+// smallest and largest element of all ranges, each range read once
+template<std::ranges::forward_range... Rs>
+requires (sizeof...(Rs) > 0)
+std::pair<detail::CommonValue<Rs...>, detail::CommonValue<Rs...>> minmax(Rs const&... ranges)
+{
+    using CT = detail::CommonValue<Rs...>;
+    bool any = false;
+    std::pair<CT, CT> result{};
+    auto take = [&](auto const& r) {
+        if (!std::ranges::empty(r)) {
+            auto [lo, hi] = detail::minmaxOf(r);
+            if (!any || static_cast<CT>(lo) < result.first) {
+                result.first = static_cast<CT>(lo);
+            }
+            if (!any || result.second < static_cast<CT>(hi)) {
+                result.second = static_cast<CT>(hi);
+            }
+            any = true;
+        }
+    };
+    (take(ranges), ...);
+    assert(any && "all ranges are empty");
+    return result;
+}
+
+// the position of the first largest element (the size of the range if it is empty)
+template<std::ranges::forward_range R>
+std::size_t argmax(R const& r)
+{
+    if (std::ranges::empty(r)) {
+        return static_cast<std::size_t>(std::ranges::distance(r));
+    }
+    if constexpr (detail::vectorizable<R>) {
+        auto const* p = std::ranges::data(r);
+        std::size_t n = std::ranges::size(r);
+        if (n < detail::parallelThreshold) {
+            return detail::argmaxBlocks(p, n).second;
+        }
+        auto parts = detail::forChunks(n, [=](std::size_t first, std::size_t count) {
+            auto [value, pos] = detail::argmaxBlocks(p + first, count);
+            return std::pair(value, pos + first);
+        });
+        auto best = parts[0];
+        for (auto const& part : parts) {
+            if (best.first < part.first) {       // strict: earlier chunks win ties
+                best = part;
+            }
+        }
+        return best.second;
+    }
+    else {
+        return static_cast<std::size_t>(std::ranges::distance(std::ranges::begin(r),
+                                                              std::ranges::max_element(r)));
+    }
+}
+
+}  // namespace range
+
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <random>
+#include <string>
+
+int main()
+{
+    std::vector<int> ints = {3, 42, -7, 42};
+    std::vector<double> doubles = {3.4, -6.7, 41.5};
+    std::list<std::string> names = {"math", "mathematics", "nico"};
+
+    auto m = range::max(ints, doubles);                  // double: 42
+    auto [lo, hi] = range::minmax(ints, doubles);        // -7 42
+    std::cout << m << ' ' << lo << ' ' << hi << ' ' << range::argmax(ints) << '\n';    // 42 -7 42 1
+    std::cout << range::max(names) << ' ' << range::min(names) << '\n';                 // nico math
+
+    // tens of millions of values
+    constexpr std::size_t n = 40'000'000;
+    std::mt19937 rnd(42);
+    std::vector<float> values(n);
+    for (auto& v : values) {
+        v = static_cast<float>(rnd()) / 1000.0f;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    auto t0 = Clock::now();
+    auto pos1 = std::max_element(values.begin(), values.end()) - values.begin();
+    auto t1 = Clock::now();
+    auto pos2 = range::argmax(values);
+    auto t2 = Clock::now();
+    float max1 = *std::max_element(values.begin(), values.end());
+    auto t3 = Clock::now();
+    float max2 = range::max(values);
+    auto t4 = Clock::now();
+
+    std::cout << "std::max_element (position): " << ms(t1 - t0) << " ms, range::argmax: "
+              << ms(t2 - t1) << " ms" << (pos1 == static_cast<std::ptrdiff_t>(pos2) ? "" : " MISMATCH") << '\n';
+    std::cout << "std::max_element (value):    " << ms(t3 - t2) << " ms, range::max:    "
+              << ms(t4 - t3) << " ms" << (max1 == max2 ? "" : " MISMATCH") << '\n';
+}
@@ -0,0 +1,146 @@
+// Runtime Size to Compile-time Specialization
+
+// Helper<sz> in execution_path_selection.cpp and Stack<T, MaxSize> in
+// nontype_template_parameters.cpp need the size at compile time: only then
+// can loops be fully unrolled, arrays be sized exactly, and a specialization
+// be selected. Often the size is only known at runtime, but it is small and
+// comes from a known distribution (e.g. most requests carry 1 to 16 items).
+
+// dispatchSize<MaxSize>(n, kernel, fallback) bridges the two:
+//  - a std::index_sequence creates the instantiations kernel(size<1>) ...
+//    kernel(size<MaxSize>) and a table of pointers to them, at compile time
+//  - at runtime, n indexes the table: one bounds check and one indirect call
+//    (a jump table, no chain of comparisons)
+//  - sizes above MaxSize (or 0) go to the generic fallback(n)
+// The kernel is a generic lambda (or any callable) whose first parameter is a
+// std::integral_constant<std::size_t, sz>, so inside it, sz is a constant
+// expression (template argument, array bound, if constexpr, ...).
+// Every size is a separate instantiation, so MaxSize trades code size for
+// coverage: pick it from the sizes that actually occur.
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+
+template<std::size_t sz>
+using Size = std::integral_constant<std::size_t, sz>;
+
+namespace dispatch_detail {
+
+template<std::size_t sz, typename R, typename Kernel, typename... Args>
+R invokeFixed(Kernel& kernel, Args&&... args)
+{
+	return kernel(Size<sz>{}, std::forward<Args>(args)...);
+}
+
+}  // namespace dispatch_detail
+
+template<std::size_t MaxSize, typename Kernel, typename Fallback, typename... Args>
+decltype(auto) dispatchSize(std::size_t n, Kernel&& kernel, Fallback&& fallback, Args&&... args)
+{
+	using K = std::remove_reference_t<Kernel>;
+	using R = decltype(fallback(n, std::forward<Args>(args)...));
+	using Fn = R (*)(K&, Args&&...);
+
+	// table[i] calls kernel(Size<i + 1>{}, args...)
+	static constexpr auto table = []<std::size_t... I>(std::index_sequence<I...>) {
+		return std::array<Fn, sizeof...(I)>{
+			&dispatch_detail::invokeFixed<I + 1, R, K, Args...>...
+		};
+	}(std::make_index_sequence<MaxSize>{});
+
+	if (n - 1 < MaxSize) {                           // 1 <= n <= MaxSize
+		return table[n - 1](kernel, std::forward<Args>(args)...);
+	}
+	return fallback(n, std::forward<Args>(args)...);
+}
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+template<typename T>
+inline void compareSwap(T& a, T& b)
+{
+	T x = a;
+	T y = b;
+	a = y < x ? y : x;
+	b = y < x ? x : y;
+}
+
+// odd-even transposition sort: for a constant sz, the compiler unrolls both
+// loops into a fixed sequence of branchless compare-exchanges
+template<std::size_t sz, typename T>
+void sortFixed(T* p)
+{
+	for (std::size_t round = 0; round < sz; ++round) {
+		for (std::size_t i = round % 2; i + 1 < sz; i += 2) {
+			compareSwap(p[i], p[i + 1]);
+		}
+	}
+}
+
+// sorts n elements, with a specialized kernel for every n up to 16
+template<typename T>
+void sortSmall(T* p, std::size_t n)
+{
+	dispatchSize<16>(n,
+		[](auto sz, T* q) {
+			sortFixed<sz>(q);
+		},
+		[](std::size_t m, T* q) {
+			std::sort(q, q + m);
+		},
+		p);
+}
+
+int main()
+{
+	// runtime sizes, as they would come from the requests
+	std::mt19937 rnd(42);
+	std::vector<std::uint32_t> sizes;
+	std::size_t total = 0;
+	while (total < 20'000'000) {
+		std::uint32_t sz = rnd() % 100 < 95 ? 1 + rnd() % 16 : 17 + rnd() % 100;
+		sizes.push_back(sz);
+		total += sz;
+	}
+	std::vector<std::int32_t> data(total);
+	for (auto& x : data) {
+		x = static_cast<std::int32_t>(rnd());
+	}
+	auto data1 = data;
+	auto data2 = data;
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	auto t0 = Clock::now();
+	for (std::size_t i = 0, pos = 0; i < sizes.size(); pos += sizes[i++]) {
+		std::sort(data1.data() + pos, data1.data() + pos + sizes[i]);
+	}
+	auto t1 = Clock::now();
+	for (std::size_t i = 0, pos = 0; i < sizes.size(); pos += sizes[i++]) {
+		sortSmall(data2.data() + pos, sizes[i]);
+	}
+	auto t2 = Clock::now();
+
+	std::cout << sizes.size() << " runs\n";
+	std::cout << "std::sort:  " << ms(t1 - t0) << " ms\n";
+	std::cout << "sortSmall:  " << ms(t2 - t1) << " ms" << (data1 == data2 ? "" : " MISMATCH") << '\n';
+
+	// the kernel may return values, e.g. results computed from sz
+	auto describe = [](auto sz) -> long {
+		return static_cast<long>(sz * sz);
+	};
+	std::cout << dispatchSize<8>(5, describe, [](std::size_t n) -> long { return -long(n); }) << ' '
+	          << dispatchSize<8>(9, describe, [](std::size_t n) -> long { return -long(n); }) << '\n';  // 25 -9
+}
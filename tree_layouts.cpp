@@ -0,0 +1,243 @@
+// Cache-friendly Layouts for Read-mostly Node Trees
+
+// A tree built from Node (see fold_expressions.cpp) with new is laid out
+// however the allocator handed out the memory. A search from the root to a
+// leaf touches one node per level and each of them is likely a different
+// cache line somewhere in the heap.
+
+// If a tree is built rarely but searched often, it pays to rewrite it once
+// into a layout that matches the access pattern:
+
+//  1. BFS order: the nodes are stored level by level in one array and refer to
+//     their children by 32-bit index. The shape of the tree is kept, but the
+//     top levels, which every search passes, are packed into the first few
+//     cache lines and stay hot.
+
+//  2. Eytzinger order: for a binary search tree only the in-order sequence of
+//     the values matters. They are stored as an implicit complete tree
+//     (the children of k are 2k and 2k+1, as in a binary heap), so there are
+//     no child links at all, the tree is balanced, and the search can prefetch
+//     a few levels ahead because the addresses are computed, not loaded.
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct Node {
+    int value;
+    Node* left;
+    Node* right;
+    Node(int i = 0) : value(i), left(nullptr), right(nullptr) {}
+};
+
+
+// 1. BFS order ------------------------------------------------------------
+
+struct BfsNode {
+    using index_type = std::uint32_t;
+    static constexpr index_type null = std::numeric_limits<index_type>::max();
+
+    int value;
+    index_type left;
+    index_type right;
+};
+
+class BfsTree {
+private:
+    std::vector<BfsNode> nodes;      // nodes[0] is the root
+public:
+    using index_type = BfsNode::index_type;
+
+    // relinearization pass: copies the tree rooted at root
+    explicit BfsTree(Node const* root) {
+        if (root == nullptr) {
+            return;
+        }
+        // the vector itself is the BFS queue: when node i is popped, its
+        // children are appended, so their index is known right away
+        std::vector<Node const*> queue{root};
+        nodes.push_back(BfsNode{root->value, BfsNode::null, BfsNode::null});
+        for (std::size_t i = 0; i < queue.size(); ++i) {
+            Node const* n = queue[i];
+            if (n->left) {
+                nodes[i].left = static_cast<index_type>(queue.size());
+                queue.push_back(n->left);
+                nodes.push_back(BfsNode{n->left->value, BfsNode::null, BfsNode::null});
+            }
+            if (n->right) {
+                nodes[i].right = static_cast<index_type>(queue.size());
+                queue.push_back(n->right);
+                nodes.push_back(BfsNode{n->right->value, BfsNode::null, BfsNode::null});
+            }
+        }
+    }
+
+    std::size_t size() const {
+        return nodes.size();
+    }
+    BfsNode const& operator[] (index_type i) const {
+        return nodes[i];
+    }
+    index_type root() const {
+        return nodes.empty() ? BfsNode::null : 0;
+    }
+
+    // binary search tree lookup (left subtree < value <= right subtree)
+    // returns the index of a node with the value or BfsNode::null
+    index_type find(int value) const {
+        index_type i = root();
+        while (i != BfsNode::null && nodes[i].value != value) {
+            i = value < nodes[i].value ? nodes[i].left : nodes[i].right;
+        }
+        return i;
+    }
+};
+
+// member "pointers" and traverse() as for Node*, but following indices
+auto bfsLeft = &BfsNode::left;
+auto bfsRight = &BfsNode::right;
+
+template<typename... TP>
+BfsNode::index_type traverse(BfsTree const& tree, BfsNode::index_type i, TP... paths) {
+    ((i = tree[i].*paths), ...);
+    return i;
+}
+
+
+// 2. Eytzinger order ------------------------------------------------------
+
+class EytzingerTree {
+private:
+    std::vector<int> values;         // 1-based: values[0] is unused
+    std::size_t n = 0;
+
+    // iterative in-order traversal: the trees that need this pass most,
+    // degenerated (list-like) ones, are too deep for recursion
+    template<typename Op>
+    static void inorder(Node const* node, Op& op) {
+        std::vector<Node const*> stack;
+        while (node != nullptr || !stack.empty()) {
+            while (node != nullptr) {
+                stack.push_back(node);
+                node = node->left;
+            }
+            node = stack.back();
+            stack.pop_back();
+            op(node->value);
+            node = node->right;
+        }
+    }
+
+    // fill the implicit tree in in-order, so it becomes a search tree again
+    // (the implicit tree is balanced: the recursion is only log n deep)
+    template<typename It>
+    void fill(It& pos, std::size_t k) {
+        if (k <= n) {
+            fill(pos, 2 * k);
+            values[k] = *pos++;
+            fill(pos, 2 * k + 1);
+        }
+    }
+
+    template<typename Op>
+    void forEach(std::size_t k, Op& op) const {
+        if (k <= n) {
+            forEach(2 * k, op);
+            op(values[k]);
+            forEach(2 * k + 1, op);
+        }
+    }
+
+public:
+    // relinearization pass: root has to be a binary search tree
+    explicit EytzingerTree(Node const* root) {
+        std::vector<int> sorted;
+        auto collect = [&](int v) { sorted.push_back(v); };
+        inorder(root, collect);
+        n = sorted.size();
+        values.resize(n + 1);
+        auto pos = sorted.cbegin();
+        fill(pos, 1);
+    }
+
+    std::size_t size() const {
+        return n;
+    }
+
+    // branchless lower bound: descend to a leaf, going right whenever the
+    // value is too small. The bits of k record the path, and the last left
+    // turn (the lowest 0 bit) is the answer.
+    // returns a pointer to the smallest value >= x or nullptr
+    int const* lowerBound(int x) const {
+        std::size_t k = 1;
+        while (k <= n) {
+            // 16 ints are one 64-byte cache line: the line with the
+            // descendants 4 levels down (the address is computed as an
+            // integer, as it may lie past the end of the vector)
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(reinterpret_cast<void const*>(
+                reinterpret_cast<std::uintptr_t>(values.data()) + 16 * k * sizeof(int)));
+#endif
+            k = 2 * k + (values[k] < x);
+        }
+        k >>= std::countr_one(k) + 1;
+        return k == 0 ? nullptr : &values[k];
+    }
+
+    bool contains(int x) const {
+        int const* p = lowerBound(x);
+        return p != nullptr && *p == x;
+    }
+
+    // in-order traversal (ascending values)
+    template<typename Op>
+    void forEach(Op op) const {
+        forEach(1, op);
+    }
+};
+
+
+#include <iostream>
+
+Node* insert(Node* root, int value)
+{
+    if (root == nullptr) {
+        return new Node{value};
+    }
+    if (value < root->value) {
+        root->left = insert(root->left, value);
+    }
+    else {
+        root->right = insert(root->right, value);
+    }
+    return root;
+}
+
+int main()
+{
+    Node* root = nullptr;
+    for (int v : {50, 20, 80, 10, 30, 70, 90, 25, 35}) {
+        root = insert(root, v);
+    }
+
+    BfsTree bfs(root);
+    std::cout << bfs[traverse(bfs, bfs.root(), bfsLeft, bfsRight)].value << '\n';   // 30
+    std::cout << (bfs.find(35) != BfsNode::null) << '\n';
+
+    EytzingerTree eytz(root);
+    std::cout << *eytz.lowerBound(31) << ' ' << eytz.contains(70) << '\n';           // 35 1
+    eytz.forEach([](int v) { std::cout << v << ' '; });
+    std::cout << '\n';
+
+    // a degenerated tree: values inserted in ascending order form a list
+    // of right children, a million levels deep
+    std::vector<Node> chain(1'000'000);
+    for (std::size_t i = 0; i < chain.size(); ++i) {
+        chain[i].value = static_cast<int>(i);
+        chain[i].right = i + 1 < chain.size() ? &chain[i + 1] : nullptr;
+    }
+    EytzingerTree balanced(chain.data());
+    std::cout << balanced.size() << ' ' << *balanced.lowerBound(123456) << '\n';   // 1000000 123456
+}
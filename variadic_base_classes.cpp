@@ -1,29 +1,159 @@
 // Variadic Base Classes
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
 #include <unordered_set>
 
 
+// A fast string hash in the style of wyhash:
+// the input is read 8 or 16 bytes at a time, and every chunk is mixed in by one
+// 64x64->128 bit multiplication whose two halves are xor-ed ("mum")
+// std::hash<std::string> (murmur-based in libstdc++) needs several
+// multiplications and shifts per 8 bytes.
+// NOTE: the value is only meant for hash tables in one process; it depends on the
+// byte order of the platform and is not compatible with the reference wyhash.
+namespace wyhash_detail {
+
+constexpr std::uint64_t p0 = 0xa0761d6478bd642full;
+constexpr std::uint64_t p1 = 0xe7037ed1a0b428dbull;
+constexpr std::uint64_t p2 = 0x8ebc6af09c88c6e3ull;
+constexpr std::uint64_t p3 = 0x589965cc75374cc3ull;
+
+inline std::uint64_t mum(std::uint64_t a, std::uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+	return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#else
+	std::uint64_t ha = a >> 32, la = a & 0xffffffffu, hb = b >> 32, lb = b & 0xffffffffu;
+	std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	std::uint64_t t = rl + (rm0 << 32);
+	std::uint64_t c = t < rl;
+	std::uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	return lo ^ hi;
+#endif
+}
+
+inline std::uint64_t read8(unsigned char const* p)
+{
+	std::uint64_t v;
+	std::memcpy(&v, p, 8);
+	return v;
+}
+
+inline std::uint64_t read4(unsigned char const* p)
+{
+	std::uint32_t v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+}
+
+inline std::uint64_t hashName(std::string_view s, std::uint64_t seed = 0)
+{
+	using namespace wyhash_detail;
+	auto p = reinterpret_cast<unsigned char const*>(s.data());
+	std::size_t len = s.size();
+	std::uint64_t a, b;
+	seed ^= mum(seed ^ p0, p1);
+	if (len <= 16) {
+		if (len >= 4) {
+			// two (possibly overlapping) 4-byte reads from each end
+			std::size_t off = (len >> 3) << 2;
+			a = (read4(p) << 32) | read4(p + off);
+			b = (read4(p + len - 4) << 32) | read4(p + len - 4 - off);
+		}
+		else if (len > 0) {
+			a = (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[len >> 1]) << 8) | p[len - 1];
+			b = 0;
+		}
+		else {
+			a = b = 0;
+		}
+	}
+	else {
+		std::size_t i = len;
+		if (i > 48) {
+			// three independent lanes for long names
+			std::uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = mum(read8(p) ^ p1, read8(p + 8) ^ seed);
+				see1 = mum(read8(p + 16) ^ p2, read8(p + 24) ^ see1);
+				see2 = mum(read8(p + 32) ^ p3, read8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = mum(read8(p) ^ p1, read8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = read8(p + i - 16);
+		b = read8(p + i - 8);
+	}
+	return mum(p1 ^ len, mum(a ^ p1, b ^ seed));
+}
+
+
+// The hash value of a customer never changes, so it is computed once,
+// when the customer is created, and stored with it
+// Every insert, lookup and rehash afterwards only reads it
 struct Customer
 {
 private:
 	std::string name;
+	std::size_t hash;
 public:
-	Customer(std::string const& n) : name(n) {}
+	Customer(std::string const& n) : name(n), hash(hashName(name)) {}
 	std::string getName() const { return name; }
+	// getName() returns a copy, which might allocate for every call
+	// getNameView() gives access to the name without copying it
+	std::string_view getNameView() const noexcept { return name; }
+	std::size_t getHash() const noexcept { return hash; }
 };
 
+// Both functors are transparent (C++20): with is_transparent defined,
+// find(), count() and contains() of unordered containers accept any type
+// the functors can be called with, so a set of Customers can be probed with
+// a std::string_view without constructing a Customer (and its string)
 struct CustomerEq
 {
-	bool operator() (Customer const& c1, Customer const& c2)
+	using is_transparent = void;
+
+	// different hash values mean different names, and comparing two integers
+	// is much cheaper than comparing two strings
+	bool operator() (Customer const& c1, Customer const& c2) const
+	{
+		return c1.getHash() == c2.getHash() && c1.getNameView() == c2.getNameView();
+	}
+	bool operator() (Customer const& c, std::string_view n) const
 	{
-		return c1.getName() == c2.getName();
+		return c.getNameView() == n;
+	}
+	bool operator() (std::string_view n, Customer const& c) const
+	{
+		return n == c.getNameView();
 	}
 };
 
+// both overloads have to agree, so a name that is not stored in a Customer
+// is hashed with the same function
 struct CustomerHash
 {
-	std::size_t operator() (Customer const& c) const {
-		return std::hash<std::string>()(c.getName());
+	using is_transparent = void;
+
+	std::size_t operator() (Customer const& c) const noexcept {
+		return c.getHash();
+	}
+	std::size_t operator() (std::string_view n) const noexcept {
+		return hashName(n);
 	}
 };
 
@@ -37,12 +167,29 @@ struct Overloader : Bases...
 	using Bases::operator()...;
 };
 
+// Note that Overloader<> is not transparent even if all its bases are:
+// is_transparent is found in more than one base class, so the name is ambiguous
+// A combination of transparent functors has to declare it again
+template<typename... Bases>
+struct TransparentOverloader : Overloader<Bases...>
+{
+	using is_transparent = void;
+};
+
 
 
 int main()
 {
-	using CustomerOP = Overloader<CustomerHash, CustomerEq>;
+	using CustomerOP = TransparentOverloader<CustomerHash, CustomerEq>;
 
 	std::unordered_set<Customer, CustomerHash, CustomerEq> coll1;
 	std::unordered_set<Customer, CustomerOP, CustomerOP> coll2;
-}
\ No newline at end of file
+
+	coll1.insert(Customer("nico"));
+	coll2.insert(Customer("nico"));
+
+	// no Customer and no std::string is created for the lookup
+	bool found = coll1.contains(std::string_view("nico"))
+	             && coll2.find(std::string_view("nico")) != coll2.end();
+	return found ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+// Copy-free Variadic max(), min() and clamp()
+
+// The max() templates in function_templates.cpp take their arguments by value:
+//     template<typename T1, typename T2>
+//     auto max(T1 a, T2 b) { return b < a ? a : b; }
+// For std::string, ::max(s1, s2) copies both strings into the parameters and
+// then a third time into the return value, only to compare them once.
+// And std::max({a, b, c}) for more than two values copies all of them into
+// the std::initializer_list and returns the result by value.
+
+// The functions here take any number of arguments by forwarding reference,
+// and the result type depends on what was passed:
+//  - all arguments are lvalues of the same type (ignoring const):
+//    the result is a reference to the winning argument, no copy at all
+//    (a const reference if any argument is const)
+//  - otherwise (different types, or temporaries that would dangle):
+//    the result is a value of std::common_type_t of the arguments, like the
+//    common_type version of ::max(), and only the winner is copied or moved
+//    into it: the arguments are compared where they are, and the result is
+//    constructed once, after the last comparison
+// Fold expressions handle any number of arguments. As with std::max()
+// and std::min(), the first of several equal arguments wins.
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace minmax_detail {
+
+template<typename T, typename... Ts>
+constexpr bool sameLvalues = std::is_lvalue_reference_v<T>
+                             && (std::is_lvalue_reference_v<Ts> && ...)
+                             && (std::is_same_v<std::remove_cvref_t<T>, std::remove_cvref_t<Ts>> && ...);
+
+// T const& if any argument is const, else T&
+template<typename T, typename... Ts>
+using RefResult = std::conditional_t<(std::is_const_v<std::remove_reference_t<T>> || ...
+                                      || std::is_const_v<std::remove_reference_t<Ts>>),
+                                     std::remove_cvref_t<T> const&,
+                                     std::remove_cvref_t<T>&>;
+
+template<typename T, typename... Ts>
+using ValueResult = std::common_type_t<std::decay_t<T>, std::decay_t<Ts>...>;
+
+// the index of the winning argument: argument J replaces the current winner
+// if better(winner, argument J); both are compared as R const&, which binds
+// arguments of type R directly and converts only arguments of other types
+template<typename R, typename Tuple, typename Better, std::size_t... I>
+constexpr std::size_t winnerIndex(Tuple& args, Better better, std::index_sequence<I...>)
+{
+    std::size_t winner = 0;
+    auto challenge = [&]<std::size_t J>(std::integral_constant<std::size_t, J>) {
+        std::size_t current = winner;
+        ((I == current && better(static_cast<R const&>(std::get<I>(args)),
+                                 static_cast<R const&>(std::get<J>(args)))
+              ? void(winner = J) : void()), ...);
+    };
+    (challenge(std::integral_constant<std::size_t, I>{}), ...);
+    return winner;
+}
+
+// R constructed once from argument winner (moved if it is an rvalue)
+template<typename R, std::size_t I = 0, typename Tuple>
+constexpr R constructFrom(std::size_t winner, Tuple&& args)
+{
+    if constexpr (I + 1 < std::tuple_size_v<std::remove_reference_t<Tuple>>) {
+        if (winner != I) {
+            return constructFrom<R, I + 1>(winner, std::move(args));
+        }
+    }
+    return R(std::get<I>(std::move(args)));
+}
+
+}  // namespace minmax_detail
+
+
+// the largest argument: b replaces the current result if result < b
+template<typename T, typename... Ts>
+constexpr decltype(auto) max(T&& a, Ts&&... rest)
+{
+    using namespace minmax_detail;
+    if constexpr (sameLvalues<T, Ts...>) {
+        // only the address of the winner is copied
+        std::remove_reference_t<RefResult<T, Ts...>>* result = &a;
+        ((result = *result < rest ? &rest : result), ...);
+        return static_cast<RefResult<T, Ts...>>(*result);
+    }
+    else {
+        // the arguments stay where they are until the winner is known
+        using R = ValueResult<T, Ts...>;
+        auto args = std::forward_as_tuple(std::forward<T>(a), std::forward<Ts>(rest)...);
+        std::size_t winner = winnerIndex<R>(args, [](R const& x, R const& y) { return x < y; },
+                                            std::index_sequence_for<T, Ts...>{});
+        return constructFrom<R>(winner, std::move(args));
+    }
+}
+
+// the smallest argument: b replaces the current result if b < result
+template<typename T, typename... Ts>
+constexpr decltype(auto) min(T&& a, Ts&&... rest)
+{
+    using namespace minmax_detail;
+    if constexpr (sameLvalues<T, Ts...>) {
+        std::remove_reference_t<RefResult<T, Ts...>>* result = &a;
+        ((result = rest < *result ? &rest : result), ...);
+        return static_cast<RefResult<T, Ts...>>(*result);
+    }
+    else {
+        using R = ValueResult<T, Ts...>;
+        auto args = std::forward_as_tuple(std::forward<T>(a), std::forward<Ts>(rest)...);
+        std::size_t winner = winnerIndex<R>(args, [](R const& x, R const& y) { return y < x; },
+                                            std::index_sequence_for<T, Ts...>{});
+        return constructFrom<R>(winner, std::move(args));
+    }
+}
+
+// v limited to [lo, hi] (requires !(hi < lo)), the same rules for the result
+template<typename T, typename L, typename H>
+constexpr decltype(auto) clamp(T&& v, L&& lo, H&& hi)
+{
+    using namespace minmax_detail;
+    if constexpr (sameLvalues<T, L, H>) {
+        using R = RefResult<T, L, H>;
+        return static_cast<R>(v < lo ? lo : hi < v ? hi : v);
+    }
+    else {
+        using R = ValueResult<T, L, H>;
+        if (v < lo) {
+            return R(std::forward<L>(lo));
+        }
+        if (hi < v) {
+            return R(std::forward<H>(hi));
+        }
+        return R(std::forward<T>(v));
+    }
+}
+
+
+static_assert(::max(1, 7, 3) == 7 && ::min(4, 7.5, 2) == 2.0);
+static_assert(std::is_same_v<decltype(::max(1, 7.5)), double>);
+
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// a string that counts how often it is copied
+struct Counted
+{
+    static inline long copies = 0;
+    std::string s;
+
+    Counted(std::string str) : s(std::move(str)) {}
+    Counted(Counted const& other) : s(other.s) { ++copies; }
+    Counted(Counted&&) = default;
+    Counted& operator= (Counted const& other) { s = other.s; ++copies; return *this; }
+    Counted& operator= (Counted&&) = default;
+    friend bool operator< (Counted const& a, Counted const& b) { return a.s < b.s; }
+};
+
+// the by-value version of function_templates.cpp
+template<typename T1, typename T2>
+auto maxByValue(T1 a, T2 b)
+{
+    return b < a ? a : b;
+}
+
+int main()
+{
+    std::string s1 = "mathematics";
+    std::string s2 = "math";
+    std::string const s3 = "nico";
+
+    ::max(s1, s2) += "!";                                   // std::string&: modifies s1
+    std::string const& m = ::max(s1, s2, s3);               // std::string const&: s3
+    std::cout << s1 << ' ' << m << ' ' << (&m == &s3) << '\n';   // mathematics! nico 1
+    std::cout << ::min(s1, std::string("a")) << ' '         // std::string (a temporary is involved): a
+              << ::clamp(12, 0, 10) << '\n';                // 10
+
+    // copies per call, with three arguments
+    Counted a("x" + std::string(100, 'a'));
+    Counted b("x" + std::string(100, 'b'));
+    Counted c("x" + std::string(100, 'c'));
+
+    Counted::copies = 0;
+    Counted r1 = maxByValue(maxByValue(a, b), c);
+    long byValue = Counted::copies;
+    Counted::copies = 0;
+    Counted r2 = std::max({a, b, c});
+    long initList = Counted::copies;
+    Counted::copies = 0;
+    Counted const& r3 = ::max(a, b, c);
+    long variadic = Counted::copies;
+    std::cout << "copies: by value " << byValue << ", std::max({...}) " << initList
+              << ", ::max(a, b, c) " << variadic << '\n';              // 5 4 0
+    (void)r1; (void)r2; (void)r3;
+
+    // with a temporary the result is a value; the winner changes three times,
+    // but only the final winner is copied (an lvalue) or moved (the temporary)
+    Counted::copies = 0;
+    Counted r4 = ::max(Counted("a"), a, b, c);
+    long lvalueWins = Counted::copies;
+    Counted::copies = 0;
+    Counted r5 = ::max(a, b, c, Counted("y"));
+    long rvalueWins = Counted::copies;
+    Counted::copies = 0;
+    Counted r6 = ::min(c, b, a, Counted("a"));
+    long minWins = Counted::copies;
+    std::cout << "copies: ::max(tmp, a, b, c) " << lvalueWins << ", ::max(a, b, c, tmp) " << rvalueWins
+              << ", ::min(c, b, a, tmp) " << minWins << '\n';        // 1 0 0
+    std::cout << (r4.s == c.s) << (r5.s == "y") << (r6.s == "a") << '\n';      // 111
+
+    // and the time it takes
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    constexpr int n = 1'000'000;
+    std::size_t sum = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < n; ++i) {
+        sum += maxByValue(maxByValue(a, b), c).s.size();
+    }
+    auto t1 = Clock::now();
+    for (int i = 0; i < n; ++i) {
+        sum += std::max({a, b, c}).s.size();
+    }
+    auto t2 = Clock::now();
+    for (int i = 0; i < n; ++i) {
+        sum += ::max(a, b, c).s.size();
+    }
+    auto t3 = Clock::now();
+    std::cout << "by value: " << ms(t1 - t0) << " ms, std::max({...}): " << ms(t2 - t1)
+              << " ms, ::max(a, b, c): " << ms(t3 - t2) << " ms (" << sum << ")\n";
+}